@@ -9,6 +9,7 @@
 #define THREAD_POOL_HPP
 
 #include "small_function.hpp"
+#include "bench_affinity.hpp"
 
 #include <condition_variable>
 #include <cstddef>
@@ -21,6 +22,9 @@
     The pool uses a fixed number of threads and pre-allocates
     storage for the task queue to avoid allocations after
     construction. It uses small_function to store tasks.
+
+    Workers may be pinned to CPUs so the kernel does not migrate
+    them and coroutine frames stay warm in one core's caches.
 */
 class thread_pool
 {
@@ -54,11 +58,35 @@ class thread_pool
 public:
     explicit
     thread_pool(std::size_t num_threads)
+        : thread_pool(num_threads, {})
+    {
+    }
+
+    /** Construct a pool whose worker i runs on where.cpus_for(i).
+
+        Each worker pins itself before taking its first task, so no
+        task runs on an unpinned thread. This is the same placement
+        io_context threads take in coro-first-io, so a pool can pin
+        one worker per CPU, share a CPU set, or spread across physical
+        cores before SMT siblings.
+
+        @see affinity::placement
+    */
+    thread_pool(
+        std::size_t num_threads,
+        affinity::placement const& where)
     {
         queue_.reserve(64);
         threads_.reserve(num_threads);
         for(std::size_t i = 0; i < num_threads; ++i)
-            threads_.emplace_back([this] { worker(); });
+        {
+            threads_.emplace_back([this, cpus = where.cpus_for(i)]
+            {
+                if(! cpus.empty())
+                    affinity::pin_this_thread(cpus);
+                worker();
+            });
+        }
     }
 
     ~thread_pool()
@@ -9,16 +9,41 @@
 
 #include "bench_cb.hpp"
 #include "bench_co.hpp"
+#include "bench_file.hpp"
+#include "bench_gen.hpp"
+#include "bench_mmap.hpp"
+#include "bench_sr.hpp"
+#include "bench_trace.hpp"
+#include "bench_perf.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <climits>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
-static std::size_t g_alloc_count = 0;
-std::size_t g_io_count = 0;
-std::size_t g_work_count = 0;
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+
+static thread_local std::size_t g_alloc_count = 0;
+constinit thread_local std::size_t g_io_count = 0;
+constinit thread_local std::size_t g_work_count = 0;
 
 void* operator new(std::size_t size)
 {
@@ -38,6 +63,240 @@ void operator delete(void* p, std::size_t) noexcept
     std::free(p);
 }
 
+// Root tasks for the spawn benchmark
+static co::task empty_task()
+{
+    co_return;
+}
+
+static co::task counted_task(int& done)
+{
+    ++done;
+    co_return;
+}
+
+static co::task read_some_task(co::socket& sock, int& done)
+{
+    co_await sock.async_read_some();
+    ++done;
+}
+
+// Scatter-gather: one request per backend, issued in sequence or concurrently
+static co::task query_backend(co::socket& sock, int& done)
+{
+    co_await co::async_request(sock);
+    ++done;
+}
+
+static co::task gather_sequential(std::vector<co::socket>& backends, int& done)
+{
+    for(auto& b : backends)
+        co_await query_backend(b, done);
+}
+
+static co::task gather_group(std::vector<co::socket>& backends, int& done)
+{
+    co::task_group group;
+    for(auto& b : backends)
+        co_await group.spawn(query_backend(b, done));
+    co_await group.join();
+}
+
+#if defined(__linux__)
+// Ways of sending a file to a socket, for the zero-copy benchmark
+enum class send_method { copy, sendfile, splice };
+
+// Sends the first `size` bytes of a file, copying through `buf` or not
+static co::task send_file(co::socket& sock, int file, std::size_t size,
+    send_method method, char* buf, std::size_t buf_size)
+{
+    std::size_t off = 0;
+    while(off < size)
+    {
+        std::size_t n = 0;
+        if(method == send_method::copy)
+        {
+            auto r = ::pread(file, buf, std::min(buf_size, size - off), static_cast<off_t>(off));
+            if(r > 0)
+                n = co_await sock.async_write(buf, static_cast<std::size_t>(r));
+        }
+        else if(method == send_method::sendfile)
+            n = co_await sock.async_sendfile(file, static_cast<off_t>(off), size - off);
+        else
+            n = co_await sock.async_splice(file, static_cast<loff_t>(off), size - off);
+        if(n == 0)
+            break;
+        off += n;
+    }
+}
+
+// Reads random 4 KiB blocks until `reads` runs out, checking the
+// block number each block starts with
+static co::task random_reads(co::file& f, std::size_t blocks, std::size_t& reads,
+    char* buf, std::uint64_t seed, int& errors)
+{
+    while(reads > 0)
+    {
+        --reads;
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        std::uint64_t block = seed % blocks;
+        auto n = co_await f.async_read_at(block * 4096, buf, 4096);
+        std::uint64_t stamp;
+        std::memcpy(&stamp, buf, sizeof(stamp));
+        if(n != 4096 || stamp != block)
+            ++errors;
+    }
+}
+
+// Writes `blocks` 4 KiB blocks in 1 MiB chunks, each starting with its number
+static co::task write_blocks(co::file& f, std::size_t blocks, char* buf, int& errors)
+{
+    constexpr std::size_t per_chunk = 256;
+    for(std::size_t first = 0; first < blocks; first += per_chunk)
+    {
+        std::size_t count = std::min(per_chunk, blocks - first);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            std::uint64_t stamp = first + i;
+            std::memcpy(buf + i * 4096, &stamp, sizeof(stamp));
+        }
+        auto n = co_await f.async_write_at(first * 4096, buf, count * 4096);
+        if(n != count * 4096)
+            ++errors;
+    }
+}
+
+// Reads every byte of a view, as a parser would
+static std::uint64_t touch(std::string_view v) noexcept
+{
+    std::uint64_t sum = 0;
+    std::size_t i = 0;
+    for(; i + 8 <= v.size(); i += 8)
+    {
+        std::uint64_t w;
+        std::memcpy(&w, v.data() + i, sizeof(w));
+        sum += w;
+    }
+    for(; i < v.size(); ++i)
+        sum += static_cast<unsigned char>(v[i]);
+    return sum;
+}
+
+// Reads a stream to the end, touching every byte
+static co::task drain(co::mmap_stream& s, std::uint64_t& sum)
+{
+    for(;;)
+    {
+        auto v = co_await s.async_read_some();
+        if(v.empty())
+            break;
+        sum += touch(v);
+    }
+}
+
+// The callback equivalent of drain
+template<class Stream>
+struct drain_op
+{
+    Stream* s_;
+    std::uint64_t* sum_;
+    bool started_ = false;
+
+    void operator()()
+    {
+        if(started_)
+        {
+            auto v = s_->buffer();
+            if(v.empty())
+                return;
+            *sum_ += touch(v);
+        }
+        started_ = true;
+        s_->async_read_some(std::move(*this));
+    }
+};
+
+// Runs a session and counts it once it completes
+template<class Stream>
+static co::task counted_session(Stream& s, int& done)
+{
+    co_await co::async_session(s);
+    ++done;
+}
+
+// Reads `n` records of a replay, or until it ends
+static co::task replay_reads(co::replay_stream& s, int n)
+{
+    for(int i = 0; i < n; ++i)
+    {
+        co_await s.async_read_some();
+        if(s.at_end())
+            break;
+    }
+}
+
+// Copies a stream to the end, so that a recording of it can be
+// compared. Empty reads are records too; only `at_end()` ends it
+template<class Stream>
+static co::task copy_all(Stream& s, std::size_t& reads)
+{
+    for(;;)
+    {
+        co_await s.async_read_some();
+        if(s.at_end())
+            break;
+        ++reads;
+    }
+}
+#endif
+
+// A completion handler whose allocator returns memory to the heap,
+// counting the blocks it has handed out and not yet taken back
+struct freeing_handler
+{
+    struct allocator
+    {
+        std::size_t* live_;
+
+        void* allocate(std::size_t n) const
+        {
+            ++*live_;
+            return ::operator new(n);
+        }
+
+        void deallocate(void* p, std::size_t) const noexcept
+        {
+            --*live_;
+            ::operator delete(p);
+        }
+    };
+
+    int* count_;
+    std::size_t* live_;
+
+    allocator get_allocator() const noexcept
+    {
+        return { live_ };
+    }
+
+    void operator()() const
+    {
+        ++*count_;
+    }
+};
+
+// A type-erased socket built from an executor, like the other streams
+struct any_socket
+{
+    cb::socket<io_context::executor> sock_;
+    cb::any_stream any_;
+
+    explicit any_socket(io_context::executor ex)
+        : sock_(ex), any_(sock_) {}
+};
+
 struct bench_result
 {
     long long ns;
@@ -50,6 +309,8 @@ struct bench_test
 {
     static constexpr int N = 100000;
 
+    int failures = 0;
+
     template<class Socket, class AsyncOp>
     static bench_result bench(Socket& sock, AsyncOp op)
     {
@@ -73,8 +334,19 @@ struct bench_test
         return { ns / N, g_alloc_count / N, g_io_count / N, g_work_count / N };
     }
 
-    template<class MakeTask>
-    static bench_result bench_co(io_context& ioc, MakeTask make_task)
+    // Completes a root sender by counting it
+    struct count_receiver
+    {
+        int* count_;
+
+        void set_value() noexcept { ++*count_; }
+        void set_error(std::exception_ptr) noexcept { std::terminate(); }
+        void set_stopped() noexcept {}
+    };
+
+    // Each iteration's operation state lives on the stack
+    template<class MakeSender>
+    static bench_result bench_sr(io_context& ioc, MakeSender make_sender)
     {
         using clock = std::chrono::high_resolution_clock;
         int count = 0;
@@ -85,7 +357,8 @@ struct bench_test
         auto t0 = clock::now();
         for (int i = 0; i < N; ++i)
         {
-            co::async_run(ioc.get_executor(), make_task(count));
+            auto op = make_sender().connect(count_receiver{&count});
+            op.start();
             ioc.run();
         }
         auto t1 = clock::now();
@@ -94,6 +367,27 @@ struct bench_test
         return { ns / N, g_alloc_count / N, g_io_count / N, g_work_count / N };
     }
 
+    template<class MakeTask>
+    static bench_result bench_co(io_context& ioc, MakeTask make_task, int iterations = N)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        int count = 0;
+
+        g_alloc_count = 0;
+        g_io_count = 0;
+        g_work_count = 0;
+        auto t0 = clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            co::async_run(ioc.get_executor(), make_task(count));
+            ioc.run();
+        }
+        auto t1 = clock::now();
+
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        return { ns / iterations, g_alloc_count / iterations, g_io_count / iterations, g_work_count / iterations };
+    }
+
     static void print_line(int level, char const* stream_type, char const* op_name, char const* style, bench_result const& r, bench_result const& other)
     {
         std::cout << level << " "
@@ -110,75 +404,2432 @@ struct bench_test
         std::cout << "\n";
     }
 
-    static void print_results(int level, char const* stream_type, char const* op_name, bench_result const& cb, bench_result const& co)
+    // Steady-state operations must not allocate in either style
+    void check_allocs(int level, char const* stream_type, char const* op_name, char const* style, bench_result const& r)
+    {
+        if(r.allocs == 0)
+            return;
+        std::cout << "FAIL: " << level << " " << stream_type << " "
+                  << op_name << " " << style << " expected 0 allocs/op, got "
+                  << r.allocs << "\n";
+        ++failures;
+    }
+
+    // The "sr" row is the sender/receiver style, and the "any" row is the
+    // callback path through cb::any_stream and cb::any_handler
+    void print_results(int level, char const* stream_type, char const* op_name, bench_result const& cb, bench_result const& co, bench_result const& sr, bench_result const& any)
     {
         print_line(level, stream_type, op_name, "cb", cb, co);
         print_line(level, stream_type, op_name, "co", co, cb);
+        print_line(level, stream_type, op_name, "sr", sr, cb);
+        print_line(level, stream_type, op_name, "any", any, cb);
+        check_allocs(level, stream_type, op_name, "cb", cb);
+        check_allocs(level, stream_type, op_name, "co", co);
+        check_allocs(level, stream_type, op_name, "sr", sr);
+        check_allocs(level, stream_type, op_name, "any", any);
+    }
+
+    // Allocations made by the last bench_handler run, in total
+    std::size_t handler_allocs = 0;
+
+    template<class Handler, class Socket, class AsyncOp>
+    bench_result bench_handler(Socket& sock, AsyncOp op, int iterations)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        auto& ioc = *sock.get_executor().ctx_;
+        int count = 0;
+
+        g_alloc_count = 0;
+        g_io_count = 0;
+        g_work_count = 0;
+        auto t0 = clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            op(sock, Handler(count));
+            ioc.run();
+        }
+        auto t1 = clock::now();
+
+        if(count != iterations)
+        {
+            std::cout << "FAIL: " << sizeof(Handler) << " B handler completed "
+                      << count << " of " << iterations << " operations\n";
+            ++failures;
+        }
+
+        handler_allocs = g_alloc_count;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        return { ns / iterations, g_alloc_count / iterations, g_io_count / iterations, g_work_count / iterations };
+    }
+
+    // A stable op allocates at most once per operation, whatever the
+    // handler size, and does the same I/O as the moving op. The total
+    // is checked, since allocs/op rounds down
+    void check_stable(int level, char const* stream_type, char const* op_name,
+        std::size_t size, bench_result const& moved, bench_result const& stable, int iterations)
+    {
+        if(handler_allocs <= static_cast<std::size_t>(iterations) && stable.ios == moved.ios)
+            return;
+        std::cout << "FAIL: " << level << " " << stream_type << " " << op_name << " "
+                  << size << " B stable: " << handler_allocs << " allocs in "
+                  << iterations << " operations, "
+                  << stable.ios << " io/op against " << moved.ios << "\n";
+        ++failures;
+    }
+
+    template<std::size_t Size, class Socket>
+    void sweep_handler(Socket& sock, char const* stream_type)
+    {
+        using handler = cb::sized_callback<Size>;
+        char style[16];
+        bench_result moved, stable;
+
+        if constexpr(requires(handler h) { sock.async_read_some(cb::stable, std::move(h)); })
+        {
+            moved = bench_handler<handler>(sock, [](auto& s, auto h){ s.async_read_some(std::move(h)); }, N / 10);
+            stable = bench_handler<handler>(sock, [](auto& s, auto h){ s.async_read_some(cb::stable, std::move(h)); }, N / 10);
+            std::snprintf(style, sizeof(style), "%4zu B moved ", Size);
+            print_line(1, stream_type, "read_some", style, moved, stable);
+            std::snprintf(style, sizeof(style), "%4zu B stable", Size);
+            print_line(1, stream_type, "read_some", style, stable, moved);
+            check_stable(1, stream_type, "read_some", Size, moved, stable, N / 10);
+        }
+
+        moved = bench_handler<handler>(sock, [](auto& s, auto h){ cb::async_request(s, std::move(h)); }, N / 10);
+        stable = bench_handler<handler>(sock, [](auto& s, auto h){ cb::async_request(s, cb::stable, std::move(h)); }, N / 10);
+        std::snprintf(style, sizeof(style), "%4zu B moved ", Size);
+        print_line(3, stream_type, "request", style, moved, stable);
+        std::snprintf(style, sizeof(style), "%4zu B stable", Size);
+        print_line(3, stream_type, "request", style, stable, moved);
+        check_stable(3, stream_type, "request", Size, moved, stable, N / 10);
+
+        moved = bench_handler<handler>(sock, [](auto& s, auto h){ cb::async_session(s, std::move(h)); }, N / 100);
+        stable = bench_handler<handler>(sock, [](auto& s, auto h){ cb::async_session(s, cb::stable, std::move(h)); }, N / 100);
+        std::snprintf(style, sizeof(style), "%4zu B moved ", Size);
+        print_line(4, stream_type, "session", style, moved, stable);
+        std::snprintf(style, sizeof(style), "%4zu B stable", Size);
+        print_line(4, stream_type, "session", style, stable, moved);
+        check_stable(4, stream_type, "session", Size, moved, stable, N / 100);
+    }
+
+    // Starts an operation whose handler's allocator really frees, then
+    // destroys the io_context before it runs, so its queued io_op is
+    // released through work::destroy instead of completing
+    template<class Stream, class AsyncOp>
+    void abandon(char const* stream_type, char const* op_name, AsyncOp op)
+    {
+        int count = 0;
+        std::size_t live = 0;
+        auto ioc = std::make_unique<io_context>();
+        Stream s(ioc->get_executor());
+        op(s, freeing_handler{&count, &live});
+        ioc.reset();
+        if(count == 0 && live == 0)
+            return;
+        std::cout << "FAIL: abandoned " << stream_type << " " << op_name
+                  << " completed " << count << " times and left "
+                  << live << " blocks allocated\n";
+        ++failures;
     }
 
+    // Destroys contexts with callback operations still queued
     void
-    run()
+    abandoned()
+    {
+        abandon<cb::socket<io_context::executor>>("socket", "session",
+            [](auto& s, auto h){ cb::async_session(s, std::move(h)); });
+        abandon<cb::tls_stream<cb::socket<io_context::executor>>>("tls_stream", "session",
+            [](auto& s, auto h){ cb::async_session(s, std::move(h)); });
+        abandon<cb::socket<io_context::executor>>("socket", "session any_handler",
+            [](auto& s, auto h){ cb::async_session(s, cb::any_handler(std::move(h))); });
+        abandon<cb::socket<io_context::executor>>("socket", "session stable",
+            [](auto& s, auto h){ cb::async_session(s, cb::stable, std::move(h)); });
+        abandon<cb::tls_stream<cb::socket<io_context::executor>>>("tls_stream", "request stable",
+            [](auto& s, auto h){ cb::async_request(s, cb::stable, std::move(h)); });
+        abandon<cb::tls_stream<cb::socket<io_context::executor>>>("tls_stream", "read_some stable",
+            [](auto& s, auto h){ s.async_read_some(cb::stable, std::move(h)); });
+        abandon<any_socket>("any_stream", "read_some",
+            [](auto& s, auto h){ s.any_.async_read_some(std::move(h)); });
+        abandon<any_socket>("any_stream", "session",
+            [](auto& s, auto h){ cb::async_session(s.any_, std::move(h)); });
+    }
+
+    // Compares moving composed ops with stable-state ops as the user's handler grows
+    void
+    handler_sizes()
     {
         io_context ioc;
         auto ex = ioc.get_executor();
         cb::socket<io_context::executor> cb_sock(ex);
-        co::socket co_sock;
         cb::tls_stream<cb::socket<io_context::executor>> cb_tls(ex);
-        co::tls_stream<co::socket> co_tls;
 
-        bench_result cb, co;
+        sweep_handler<16>(cb_sock, "socket");
+        sweep_handler<64>(cb_sock, "socket");
+        sweep_handler<256>(cb_sock, "socket");
+        sweep_handler<1024>(cb_sock, "socket");
+        std::cout << "\n";
+        sweep_handler<16>(cb_tls, "tls_stream");
+        sweep_handler<64>(cb_tls, "tls_stream");
+        sweep_handler<256>(cb_tls, "tls_stream");
+        sweep_handler<1024>(cb_tls, "tls_stream");
+    }
 
-        // socket read_some (1 call) - level 1
-        cb = bench(cb_sock, [](auto& sock, auto h){ sock.async_read_some(std::move(h)); });
-        co = bench_co(ioc, [&](int& count) -> co::task { co_await co_sock.async_read_some(); ++count; });
-        print_results(1, "socket", "read_some", cb, co);
+    // Spawns and completes tasks on `threads` threads, each with its own
+    // io_context, returning the aggregate throughput in tasks per second
+    template<bool Batch, bool Read>
+    double bench_spawn(unsigned threads)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        static constexpr std::size_t batch = 256;
+        static constexpr int rounds = 400;
+        std::atomic<unsigned> ready{0};
+        std::atomic<std::size_t> completed{0};
 
-        // tls_stream read_some (1 call) - level 1
-        cb = bench(cb_tls, [](auto& sock, auto h){ sock.async_read_some(std::move(h)); });
-        co = bench_co(ioc, [&](int& count) -> co::task { co_await co_tls.async_read_some(); ++count; });
-        print_results(1, "tls_stream", "read_some", cb, co);
+        auto body = [&]
+        {
+            io_context ioc;
+            auto ex = ioc.get_executor();
+            std::vector<co::socket> socks(Read ? batch : 0);
+            int done = 0;
+            auto make_task = [&](std::size_t i) -> co::task
+            {
+                if constexpr(Read)
+                    return read_some_task(socks[i], done);
+                else
+                    return counted_task(done);
+            };
 
-        std::cout << "\n";
+            ready.fetch_add(1);
+            while(ready.load() < threads)
+                std::this_thread::yield();
 
-        // socket read (5 calls) - level 2
-        cb = bench(cb_sock, [](auto& sock, auto h){ cb::async_read(sock, std::move(h)); });
-        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_read(co_sock); ++count; });
-        print_results(2, "socket", "read", cb, co);
+            for(int r = 0; r < rounds; ++r)
+            {
+                if constexpr(Batch)
+                {
+                    co::async_run_batch(ex, batch, make_task);
+                }
+                else
+                {
+                    for(std::size_t i = 0; i < batch; ++i)
+                        co::async_run(ex, make_task(i));
+                }
+                ioc.run();
+            }
+            completed.fetch_add(static_cast<std::size_t>(done));
+        };
 
-        // tls_stream read (5 calls) - level 2
-        cb = bench(cb_tls, [](auto& sock, auto h){ cb::async_read(sock, std::move(h)); });
-        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_read(co_tls); ++count; });
-        print_results(2, "tls_stream", "read", cb, co);
+        auto t0 = clock::now();
+        std::vector<std::thread> v;
+        for(unsigned i = 0; i < threads; ++i)
+            v.emplace_back(body);
+        for(auto& t : v)
+            t.join();
+        auto t1 = clock::now();
+
+        std::size_t spawned = threads * batch * rounds;
+        if(completed.load() != spawned)
+        {
+            std::cout << "FAIL: spawn " << (Batch ? "batch" : "single") << " completed "
+                      << completed.load() << " of " << spawned << " tasks\n";
+            ++failures;
+        }
+        double secs = std::chrono::duration<double>(t1 - t0).count();
+        return double(threads) * batch * rounds / secs;
+    }
+
+    // Measures spawn+complete throughput of async_run against async_run_batch
+    void
+    spawn()
+    {
+        auto print = [](char const* task, unsigned threads, double single, double batch)
+        {
+            std::cout << std::left << std::setw(9) << task << std::right
+                      << std::setw(3) << threads << " threads: "
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(7) << single / 1e6 << " Mtask/s single, "
+                      << std::setw(7) << batch / 1e6 << " Mtask/s batch\n";
+            std::cout.unsetf(std::ios::floatfield);
+        };
 
+        for(unsigned threads : {1u, 2u, 4u, 8u, 16u})
+            print("empty", threads,
+                bench_spawn<false, false>(threads),
+                bench_spawn<true, false>(threads));
         std::cout << "\n";
+        for(unsigned threads : {1u, 2u, 4u, 8u, 16u})
+            print("one-read", threads,
+                bench_spawn<false, true>(threads),
+                bench_spawn<true, true>(threads));
+    }
 
-        // socket request (10 calls) - level 2
-        cb = bench(cb_sock, [](auto& sock, auto h){ cb::async_request(sock, std::move(h)); });
-        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_request(co_sock); ++count; });
-        print_results(3, "socket", "request", cb, co);
+    // Fans one parent task out to `n` backends and joins them
+    template<class Gather>
+    bench_result bench_fanout(std::size_t n, Gather gather)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        int const iterations = N / 10;
+        io_context ioc;
+        std::vector<co::socket> backends(n);
+        int done = 0;
 
-        // tls_stream request (10 calls) - level 2
-        cb = bench(cb_tls, [](auto& sock, auto h){ cb::async_request(sock, std::move(h)); });
-        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_request(co_tls); ++count; });
-        print_results(3, "tls_stream", "request", cb, co);
+        g_alloc_count = 0;
+        g_io_count = 0;
+        g_work_count = 0;
+        auto t0 = clock::now();
+        for(int i = 0; i < iterations; ++i)
+        {
+            co::async_run(ioc.get_executor(), gather(backends, done));
+            ioc.run();
+        }
+        auto t1 = clock::now();
 
-        std::cout << "\n";
+        if(done != iterations * static_cast<int>(n))
+        {
+            std::cout << "FAIL: fan-out " << n << " completed " << done
+                      << " of " << iterations * n << " children\n";
+            ++failures;
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        return { ns / iterations, g_alloc_count / iterations, g_io_count / iterations, g_work_count / iterations };
+    }
 
-        // socket session (1000 calls) - level 3
-        cb = bench(cb_sock, [](auto& sock, auto h){ cb::async_session(sock, std::move(h)); });
-        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_session(co_sock); ++count; });
-        print_results(4, "socket", "session", cb, co);
+    // Compares awaiting backends one after another with a task_group
+    void
+    fanout()
+    {
+        for(std::size_t n : {1, 4, 16, 64})
+        {
+            auto seq = bench_fanout(n, gather_sequential);
+            auto grp = bench_fanout(n, gather_group);
+            char name[16];
+            std::snprintf(name, sizeof(name), "x%zu", n);
+            print_line(3, "fan-out", name, "seq", seq, grp);
+            print_line(3, "fan-out", name, "grp", grp, seq);
+            check_allocs(3, "fan-out", name, "seq", seq);
+            check_allocs(3, "fan-out", name, "grp", grp);
+        }
+    }
 
-        // tls_stream session (1000 calls) - level 3
-        cb = bench(cb_tls, [](auto& sock, auto h){ cb::async_session(sock, std::move(h)); });
-        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_session(co_tls); ++count; });
-        print_results(4, "tls_stream", "session", cb, co);
+    // Runs a generated shape in both styles on a socket and a tls_stream
+    void bench_shape(workload_shape const& shape)
+    {
+        // Bound the reads per row so deep or wide shapes finish quickly
+        static constexpr std::size_t budget = 1000000;
+        std::size_t reads = shape.reads(budget);
+        if(reads == 0)
+        {
+            std::cout << "shape depth=" << shape.depth << " fanout=" << shape.fanout
+                      << " performs more than " << budget << " reads, skipped\n";
+            return;
+        }
+        int iterations = static_cast<int>(std::max<std::size_t>(1,
+            std::min<std::size_t>(N, budget / 10 / reads)));
+
+        io_context ioc;
+        auto ex = ioc.get_executor();
+        cb::socket<io_context::executor> cb_sock(ex);
+        cb::tls_stream<cb::socket<io_context::executor>> cb_tls(ex);
+        co::socket co_sock;
+        co::tls_stream<co::socket> co_tls;
+
+        auto state = workload_shape::with_state_size(shape.state,
+            [](auto s) { return decltype(s)::value; });
+        char name[32];
+        std::snprintf(name, sizeof(name), "d%d f%d s%zu w%d",
+            shape.depth, shape.fanout, state, shape.work);
+
+        auto run_cb = [&](auto& sock)
+        {
+            return bench_handler<cb::callback>(sock, [&](auto& s, auto h)
+                { cb::async_generated(s, shape, std::move(h)); }, iterations);
+        };
+        auto run_co = [&](auto& sock)
+        {
+            return bench_co(ioc, [&](int& count) -> co::task
+                { co_await co::async_generated(sock, shape); ++count; }, iterations);
+        };
+
+        bench_result cb = run_cb(cb_sock);
+        bench_result co = run_co(co_sock);
+        std::cout << std::left << std::setw(11) << "socket" << std::setw(22) << name << std::right
+                  << "cb " << std::setw(8) << cb.ns << " ns/op, co " << std::setw(8) << co.ns
+                  << " ns/op, co/cb " << std::fixed << std::setprecision(2)
+                  << double(co.ns) / double(std::max<long long>(cb.ns, 1)) << "\n";
+        check_allocs(shape.depth, "socket", name, "cb", cb);
+        check_allocs(shape.depth, "socket", name, "co", co);
+
+        cb = run_cb(cb_tls);
+        co = run_co(co_tls);
+        std::cout << std::left << std::setw(11) << "tls_stream" << std::setw(22) << name << std::right
+                  << "cb " << std::setw(8) << cb.ns << " ns/op, co " << std::setw(8) << co.ns
+                  << " ns/op, co/cb " << std::fixed << std::setprecision(2)
+                  << double(co.ns) / double(std::max<long long>(cb.ns, 1)) << "\n";
+        std::cout.unsetf(std::ios::floatfield);
+        check_allocs(shape.depth, "tls_stream", name, "cb", cb);
+        check_allocs(shape.depth, "tls_stream", name, "co", co);
     }
-};
 
-int main()
-{
-    bench_test t;
+    // Sweeps nesting depth, state size and per-step work at fan-out 1
+    void
+    shapes()
+    {
+        for(std::size_t state : {0, 256})
+        {
+            for(int work : {0, 100})
+            {
+                for(int depth : {1, 2, 4, 8, 16, 32})
+                    bench_shape({ depth, 1, state, work });
+                std::cout << "\n";
+            }
+        }
+        bench_shape({ 3, 4, 64, 0 });
+        bench_shape({ 3, 10, 64, 0 });
+    }
+
+    // Runs one task to completion, recording every frame it allocates
+    template<class MakeTask>
+    void record_frames(io_context& ioc, char const* stream_type, char const* op_name, MakeTask make_task)
+    {
+        using recorder = co::detail::frame_recorder;
+        int count = 0;
+
+        recorder::clear();
+        {
+            recorder::scope s(op_name);
+            co::async_run(ioc.get_executor(), make_task(count));
+            ioc.run();
+        }
+
+        std::size_t frames = 0;
+        std::size_t bytes = 0;
+        auto entries = recorder::entries();
+        for(auto const& e : entries)
+        {
+            frames += e.count;
+            bytes += e.size * e.count;
+        }
+        std::cout << std::left << std::setw(11) << stream_type
+                  << std::setw(11) << op_name << ": "
+                  << std::right << std::setw(5) << frames << " frames, "
+                  << bytes << " bytes\n";
+        for(auto const& e : entries)
+            std::cout << "    site " << e.site << " : "
+                      << std::setw(5) << e.size << " bytes x "
+                      << e.count << "\n";
+
+        // At least the outer task's frame, tagged with the scope
+        bool tagged = std::all_of(entries.begin(), entries.end(),
+            [&](auto const& e){ return e.tag == op_name; });
+        if(count != 1 || frames == 0 || ! tagged)
+        {
+            std::cout << "FAIL: " << stream_type << " " << op_name
+                      << " expected one completed task with tagged frames\n";
+            ++failures;
+        }
+    }
+
+    // Reports the coroutine frame sizes requested by each operation
+    void
+    frames()
+    {
+        io_context ioc;
+        co::socket co_sock;
+        co::tls_stream<co::socket> co_tls;
+
+        co::detail::frame_recorder::enable(true);
+
+        record_frames(ioc, "socket", "read_some", [&](int& count) -> co::task { co_await co_sock.async_read_some(); ++count; });
+        record_frames(ioc, "tls_stream", "read_some", [&](int& count) -> co::task { co_await co_tls.async_read_some(); ++count; });
+        record_frames(ioc, "socket", "read", [&](int& count) -> co::task { co_await co::async_read(co_sock); ++count; });
+        record_frames(ioc, "tls_stream", "read", [&](int& count) -> co::task { co_await co::async_read(co_tls); ++count; });
+        record_frames(ioc, "socket", "request", [&](int& count) -> co::task { co_await co::async_request(co_sock); ++count; });
+        record_frames(ioc, "tls_stream", "request", [&](int& count) -> co::task { co_await co::async_request(co_tls); ++count; });
+        record_frames(ioc, "socket", "session", [&](int& count) -> co::task { co_await co::async_session(co_sock); ++count; });
+        record_frames(ioc, "tls_stream", "session", [&](int& count) -> co::task { co_await co::async_session(co_tls); ++count; });
+
+        co::detail::frame_recorder::enable(false);
+    }
+
+    // Times the first and the steady-state iterations of an operation on
+    // fresh threads with empty pools, optionally reserving its frames first
+    template<class Stream, class AsyncOp>
+    void bench_cold(char const* stream_type, char const* op_name, AsyncOp op, bool reserve)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        using recorder = co::detail::frame_recorder;
+        using pool = co::detail::frame_pool;
+        static constexpr int trials = 15;
+        static constexpr int steady = 1000;
+
+        // Discover the frame sizes on a throwaway thread
+        std::vector<recorder::entry> entries;
+        std::thread([&]
+        {
+            io_context ioc;
+            Stream stream;
+            recorder::clear();
+            recorder::enable(true);
+            co::async_run(ioc.get_executor(), op(stream));
+            ioc.run();
+            recorder::enable(false);
+            entries = recorder::entries();
+        }).join();
+
+        // Largest first, so that each frame takes the block of its own site
+        std::sort(entries.begin(), entries.end(),
+            [](auto const& a, auto const& b){ return a.size > b.size; });
+
+        std::vector<long long> first;
+        std::vector<long long> rest;
+        int missed = 0;
+        for(int i = 0; i < trials; ++i)
+        {
+            std::thread([&]
+            {
+                pool::trim();
+                io_context ioc;
+                Stream stream;
+                if(reserve)
+                {
+                    // Each site has one frame live at a time in these operations
+                    for(auto const& e : entries)
+                        pool::reserve(ioc, e.size, 1);
+                    ioc.run();
+                }
+
+                auto misses = pool::local_stats().misses;
+                auto t0 = clock::now();
+                co::async_run(ioc.get_executor(), op(stream));
+                ioc.run();
+                auto t1 = clock::now();
+                if(reserve && pool::local_stats().misses != misses)
+                    ++missed;
+                for(int j = 0; j < steady; ++j)
+                {
+                    co::async_run(ioc.get_executor(), op(stream));
+                    ioc.run();
+                }
+                auto t2 = clock::now();
+
+                first.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+                rest.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count() / steady);
+            }).join();
+        }
+
+        // Medians, since each trial contributes a single cold sample
+        std::sort(first.begin(), first.end());
+        std::sort(rest.begin(), rest.end());
+        std::cout << std::left << std::setw(11) << stream_type
+                  << std::setw(11) << op_name
+                  << std::setw(9) << (reserve ? "reserved" : "cold") << ": "
+                  << std::right << std::setw(7) << first[trials / 2] << " ns first, "
+                  << std::setw(7) << rest[trials / 2] << " ns steady\n";
+
+        // Reserved frames must serve the whole first iteration
+        if(missed != 0)
+        {
+            std::cout << "FAIL: " << stream_type << " " << op_name << " reserved: "
+                      << missed << " of " << trials << " first iterations missed the pool\n";
+            ++failures;
+        }
+    }
+
+    // Reports first-iteration latency with and without frame_pool::reserve
+    void
+    cold_start()
+    {
+        auto read = [](auto& s) { return co::async_read(s); };
+        auto request = [](auto& s) { return co::async_request(s); };
+        auto session = [](auto& s) { return co::async_session(s); };
+
+        bench_cold<co::socket>("socket", "read", read, false);
+        bench_cold<co::socket>("socket", "read", read, true);
+        bench_cold<co::tls_stream<co::socket>>("tls_stream", "read", read, false);
+        bench_cold<co::tls_stream<co::socket>>("tls_stream", "read", read, true);
+        bench_cold<co::socket>("socket", "request", request, false);
+        bench_cold<co::socket>("socket", "request", request, true);
+        bench_cold<co::tls_stream<co::socket>>("tls_stream", "request", request, false);
+        bench_cold<co::tls_stream<co::socket>>("tls_stream", "request", request, true);
+        bench_cold<co::socket>("socket", "session", session, false);
+        bench_cold<co::socket>("socket", "session", session, true);
+        bench_cold<co::tls_stream<co::socket>>("tls_stream", "session", session, false);
+        bench_cold<co::tls_stream<co::socket>>("tls_stream", "session", session, true);
+    }
+
+    // Awaits an empty task on one io_context, either unbound, bound with
+    // run_on to a lane of the same context, or bound to a context on
+    // another thread
+    static bench_result bench_hop(bool bound, bool remote, priority lane = priority::normal)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        int const iterations = remote ? N / 10 : N;
+        io_context a;
+        auto exa = a.get_executor();
+
+        // The other context is built and run by its own thread, which
+        // keeps it alive until the guard keeping it running is released
+        std::atomic<io_context*> pb{nullptr};
+        std::atomic<bool> released{false};
+        std::optional<io_context::work_guard> b_guard;
+        std::size_t b_allocs = 0;
+        std::thread tb;
+        if(remote)
+        {
+            tb = std::thread([&]
+            {
+                io_context b;
+                b_guard.emplace(b);
+                g_alloc_count = 0;
+                pb.store(&b, std::memory_order_release);
+                b.run();
+                b_allocs = g_alloc_count;
+                while(! released.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+            });
+            while(! pb.load(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+        auto exb = remote ? pb.load(std::memory_order_acquire)->get_executor() : a.get_executor(lane);
+
+        // Completions from the other thread arrive while the root is suspended
+        std::optional<io_context::work_guard> a_guard(std::in_place, a);
+        auto root = [&]() -> co::task
+        {
+            for(int i = 0; i < iterations; ++i)
+            {
+                if(bound)
+                    co_await co::run_on(exb, empty_task());
+                else
+                    co_await empty_task();
+            }
+            a_guard.reset();
+        };
+
+        g_alloc_count = 0;
+        g_io_count = 0;
+        g_work_count = 0;
+        auto t0 = clock::now();
+        co::async_run(exa, root());
+        a.run();
+        auto t1 = clock::now();
+        std::size_t allocs = g_alloc_count;
+        std::size_t works = g_work_count;
+        if(remote)
+        {
+            b_guard.reset();
+            released.store(true, std::memory_order_release);
+            tb.join();
+            allocs += b_allocs;
+        }
+
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+        return { ns / iterations, allocs / iterations, 0, works / iterations };
+    }
+
+    // Reports the cost of run_on: inline when the executor is the caller's,
+    // and a round trip of two hops when it is another lane of the same
+    // context or belongs to another thread
+    void
+    hop()
+    {
+        auto plain = bench_hop(false, false);
+        auto same = bench_hop(true, false);
+        auto lane = bench_hop(true, false, priority::high);
+        auto remote = bench_hop(true, true);
+        print_line(1, "run_on", "await", "co", plain, plain);
+        print_line(1, "run_on", "same", "co", same, plain);
+        print_line(1, "run_on", "lane", "co", lane, plain);
+        print_line(1, "run_on", "hop", "co", remote, plain);
+        check_allocs(1, "run_on", "await", "co", plain);
+        check_allocs(1, "run_on", "same", "co", same);
+        check_allocs(1, "run_on", "lane", "co", lane);
+        check_allocs(1, "run_on", "hop", "co", remote);
+        if(lane.works <= same.works)
+        {
+            std::cout << "FAIL: run_on to the high lane ran inline, "
+                      << lane.works << " work/op\n";
+            ++failures;
+        }
+    }
+
+    // Control-plane work whose queueing delay is measured, in time and
+    // in the number of bulk items that ran while it was queued
+    struct probe_work : work
+    {
+        using clock = std::chrono::steady_clock;
+
+        io_context::executor ex_;
+        clock::time_point posted_;
+        std::atomic<std::size_t> const* ran_ = nullptr;
+        std::size_t posted_seq_ = 0;
+        std::vector<long long> samples_;
+        std::vector<std::size_t> ahead_;
+        bool pending_ = false;
+
+        void post()
+        {
+            pending_ = true;
+            posted_ = clock::now();
+            posted_seq_ = ran_->load(std::memory_order_relaxed);
+            ex_.post(this);
+        }
+
+        void operator()() override
+        {
+            samples_.push_back(std::chrono::duration_cast<
+                std::chrono::nanoseconds>(clock::now() - posted_).count());
+            ahead_.push_back(ran_->load(std::memory_order_relaxed) - posted_seq_);
+            pending_ = false;
+        }
+    };
+
+    // Bulk data work which keeps a lane saturated by reposting itself,
+    // counting each run. One item also stands in for a timer, posting
+    // the probe whenever the previous probe has run
+    struct bulk_work : work
+    {
+        io_context::executor ex_;
+        int left_;
+        probe_work* probe_ = nullptr;
+        std::atomic<std::size_t>* ran_ = nullptr;
+
+        bulk_work(io_context::executor ex, int left, std::atomic<std::size_t>& ran)
+            : ex_(ex), left_(left), ran_(&ran) {}
+
+        void operator()() override
+        {
+            ran_->fetch_add(1, std::memory_order_relaxed);
+
+            // Stand-in for parsing or copying a buffer
+            [[maybe_unused]] static thread_local volatile unsigned sink;
+            unsigned x = 0;
+            for(int n = 0; n < 200; ++n)
+                x = x * 31 + static_cast<unsigned>(n);
+            sink = x;
+
+            if(probe_ && ! probe_->pending_)
+                probe_->post();
+            if(--left_ > 0 && ! (stop_ && stop_->load(std::memory_order_relaxed)))
+                ex_.post(this);
+        }
+
+        std::atomic<bool> const* stop_ = nullptr;
+    };
+
+    // A probe posted from another thread, which waits for it to run
+    struct remote_probe : work
+    {
+        std::uint64_t posted_ = 0;
+        std::atomic<std::size_t> const* ran_ = nullptr;
+        std::size_t posted_seq_ = 0;
+        std::vector<long long> samples_;
+        std::vector<std::size_t> ahead_;
+        std::atomic<bool> done_{false};
+
+        void operator()() override
+        {
+            samples_.push_back(static_cast<long long>(tsc::to_ns(tsc::now() - posted_)));
+            ahead_.push_back(ran_->load(std::memory_order_relaxed) - posted_seq_);
+            done_.store(true, std::memory_order_release);
+        }
+    };
+
+    // Sorted queueing delays of the probes, and sorted counts of the
+    // bulk items that ran while each probe was queued
+    struct priority_result
+    {
+        std::vector<long long> ns;
+        std::vector<std::size_t> ahead;
+
+        template<class Probe>
+        explicit priority_result(Probe& p)
+            : ns(std::move(p.samples_))
+            , ahead(std::move(p.ahead_))
+        {
+            std::sort(ns.begin(), ns.end());
+            std::sort(ahead.begin(), ahead.end());
+        }
+    };
+
+    // Measures high-priority probes posted from another thread while
+    // bulk work saturates the low lane
+    static priority_result bench_remote_priority()
+    {
+        static constexpr int items = 256;
+        static constexpr int rounds = 4000;
+        static constexpr int probes = 50;
+        io_context ioc;
+        std::atomic<bool> stop{false};
+        std::atomic<std::size_t> ran{0};
+        std::vector<bulk_work> bulk;
+        bulk.reserve(items);
+        for(int i = 0; i < items; ++i)
+        {
+            bulk.emplace_back(ioc.get_executor(priority::low), rounds, ran);
+            bulk.back().stop_ = &stop;
+        }
+        for(auto& b : bulk)
+            b.ex_.post(&b);
+
+        remote_probe p;
+        p.ran_ = &ran;
+        p.samples_.reserve(probes);
+        p.ahead_.reserve(probes);
+        std::optional<io_context::work_guard> guard(std::in_place, ioc);
+        std::thread prober([&]
+        {
+            auto ex = ioc.get_executor(priority::high);
+            for(int i = 0; i < probes; ++i)
+            {
+                p.done_.store(false, std::memory_order_relaxed);
+                p.posted_ = tsc::now();
+                p.posted_seq_ = ran.load(std::memory_order_relaxed);
+                ex.post(&p);
+                while(! p.done_.load(std::memory_order_acquire))
+                    std::this_thread::yield();
+            }
+            stop.store(true, std::memory_order_relaxed);
+            guard.reset();
+        });
+        ioc.run();
+        prober.join();
+        return priority_result(p);
+    }
+
+    // Measures probes posted to `probe_lane` while bulk work saturates `bulk_lane`
+    static priority_result bench_priority(priority bulk_lane, priority probe_lane, unsigned starvation_limit)
+    {
+        static constexpr int items = 256;
+        static constexpr int rounds = 200;
+        io_context ioc;
+        ioc.set_starvation_limit(starvation_limit);
+        std::atomic<std::size_t> ran{0};
+        probe_work probe;
+        probe.ex_ = ioc.get_executor(probe_lane);
+        probe.ran_ = &ran;
+
+        std::vector<bulk_work> bulk;
+        bulk.reserve(items);
+        for(int i = 0; i < items; ++i)
+            bulk.emplace_back(ioc.get_executor(bulk_lane), rounds, ran);
+        bulk.front().probe_ = &probe;
+        for(auto& b : bulk)
+            b.ex_.post(&b);
+        ioc.run();
+
+        return priority_result(probe);
+    }
+
+    // Reports the queueing delay of control-plane work behind bulk work.
+    // The checks count the bulk items that ran ahead of each probe, so
+    // they do not depend on how fast the machine is
+    void
+    priorities()
+    {
+        auto print = [](char const* label, priority_result const& r)
+        {
+            std::cout << std::left << std::setw(28) << label << ": " << std::right;
+            if(r.ns.empty())
+            {
+                std::cout << "starved\n";
+                return;
+            }
+            std::cout << std::setw(8) << r.ns[r.ns.size() / 2] << " ns p50, "
+                      << std::setw(8) << r.ns[r.ns.size() * 99 / 100] << " ns p99, "
+                      << std::setw(6) << r.ahead.back() << " items ahead max, "
+                      << std::setw(5) << r.ns.size() << " probes\n";
+        };
+
+        auto same = bench_priority(priority::low, priority::low, 0);
+        auto high = bench_priority(priority::low, priority::high, 0);
+        auto strict = bench_priority(priority::high, priority::low, 0);
+        auto limited = bench_priority(priority::high, priority::low, 16);
+        auto remote = bench_remote_priority();
+        print("same lane as bulk", same);
+        print("high lane over bulk", high);
+        print("low lane, strict", strict);
+        print("low lane, starvation 16", limited);
+        print("high lane, remote post", remote);
+
+        auto fail = [this](char const* what)
+        {
+            std::cout << "FAIL: priority: " << what << "\n";
+            ++failures;
+        };
+        // A local high probe runs next, before any queued bulk item
+        if(same.ns.empty() || high.ns.empty() || high.ahead.back() != 0)
+            fail("the high lane did not run ahead of bulk work");
+        // The bulk lane is never empty, so strict priority runs a low probe only at the end
+        if(strict.ns.size() > 1)
+            fail("strict priority ran the low lane while the high lane had work");
+        if(limited.ns.size() <= 1)
+            fail("the starvation limit did not let the low lane run");
+        // A remote probe joins its lane at the next check of the remote
+        // queues, at most remote_interval items later. The prober reads
+        // the count a little before it posts, so allow as many again.
+        // Before those checks, the first probe waited for the whole backlog
+        if(remote.ns.size() != 50 || remote.ahead.back() > 2 * io_context::remote_interval)
+            fail("a remote high-priority post waited behind the low lane");
+    }
+
+    // A request whose latency runs from its arrival to its completion
+    struct request_work : work
+    {
+        using clock = std::chrono::steady_clock;
+
+        clock::time_point arrived_;
+        std::vector<long long>* samples_ = nullptr;
+
+        // Stand-in for handling the request
+        static void serve() noexcept
+        {
+            [[maybe_unused]] static thread_local volatile unsigned sink;
+            unsigned x = 0;
+            for(int i = 0; i < 2000; ++i)
+                x = x * 31 + static_cast<unsigned>(i);
+            sink = x;
+        }
+
+        void operator()() override
+        {
+            serve();
+            samples_->push_back(std::chrono::duration_cast<
+                std::chrono::nanoseconds>(clock::now() - arrived_).count());
+        }
+    };
+
+    // Offers requests on a fixed schedule, like an accept loop under an
+    // open-loop client. Arrivals are refused while the context reports
+    // overload, if shedding
+    struct arrival_work : work
+    {
+        using clock = std::chrono::steady_clock;
+
+        io_context* ioc_;
+        std::vector<request_work>* requests_;
+        clock::time_point start_;
+        std::chrono::nanoseconds period_;
+        bool shed_;
+        std::size_t next_ = 0;
+        std::size_t refused_ = 0;
+
+        void operator()() override
+        {
+            auto elapsed = clock::now() - start_;
+            auto due = std::min<std::size_t>(requests_->size(),
+                static_cast<std::size_t>(elapsed / period_) + 1);
+            auto ex = ioc_->get_executor();
+            for(; next_ < due; ++next_)
+            {
+                auto& r = (*requests_)[next_];
+                r.arrived_ = start_ + next_ * period_;
+                if(shed_ && ioc_->overloaded())
+                    ++refused_;
+                else
+                    ex.post(&r);
+            }
+            if(next_ < requests_->size())
+                ex.post(this);
+        }
+    };
+
+    struct overload_result
+    {
+        long long p99 = 0;
+        std::size_t served = 0;
+        std::size_t refused = 0;
+    };
+
+    // Offers `load` times the measured capacity and reports request latency
+    static overload_result bench_overload(bool shed, std::chrono::nanoseconds service, double load)
+    {
+        using namespace std::chrono_literals;
+        static constexpr auto duration = 100ms;
+        auto period = std::chrono::duration_cast<std::chrono::nanoseconds>(service / load);
+
+        io_context ioc;
+        ioc.enable_admission_control(100us, 2ms);
+        std::vector<long long> samples;
+        std::vector<request_work> requests(static_cast<std::size_t>(duration / period));
+        samples.reserve(requests.size());
+        for(auto& r : requests)
+            r.samples_ = &samples;
+
+        arrival_work arrivals;
+        arrivals.ioc_ = &ioc;
+        arrivals.requests_ = &requests;
+        arrivals.start_ = arrival_work::clock::now();
+        arrivals.period_ = period;
+        arrivals.shed_ = shed;
+        ioc.get_executor().post(&arrivals);
+        ioc.run();
+
+        std::sort(samples.begin(), samples.end());
+        std::cout << std::left << std::setw(12) << (shed ? "codel shed" : "no shedding")
+                  << " at " << std::right << std::setw(3) << load << "x: " << std::fixed << std::setprecision(1)
+                  << std::setw(8) << samples[samples.size() / 2] / 1e3 << " us p50, "
+                  << std::setw(8) << samples[samples.size() * 99 / 100] / 1e3 << " us p99, "
+                  << std::setw(7) << samples.size() << " served, "
+                  << std::setw(7) << arrivals.refused_ << " refused\n";
+        std::cout.unsetf(std::ios::floatfield);
+        return { samples[samples.size() * 99 / 100], samples.size(), arrivals.refused_ };
+    }
+
+    // Compares tail latency at 2x offered load with and without CoDel,
+    // and checks that CoDel leaves a load under capacity alone
+    void
+    overload()
+    {
+        using clock = std::chrono::steady_clock;
+        static constexpr int calibration = 10000;
+        auto t0 = clock::now();
+        for(int i = 0; i < calibration; ++i)
+            request_work::serve();
+        auto service = (clock::now() - t0) / calibration;
+        std::cout << "service time " << std::chrono::duration_cast<
+            std::chrono::nanoseconds>(service).count() << " ns\n";
+
+        auto open = bench_overload(false, service, 2.0);
+        auto shed = bench_overload(true, service, 2.0);
+        auto light = bench_overload(true, service, 0.5);
+
+        auto fail = [this](char const* what)
+        {
+            std::cout << "FAIL: overload: " << what << "\n";
+            ++failures;
+        };
+        // The p99s of two short runs depend on what else the machine
+        // does, so they are printed above but not compared
+        if(shed.refused == 0)
+            fail("CoDel shed nothing at twice the capacity");
+        if(open.refused != 0)
+            fail("the run without shedding refused requests");
+        // A preempted loop can trip CoDel briefly, so allow a trace of refusals
+        if(light.refused * 100 > light.served + light.refused)
+            fail("CoDel shed more than 1% of a load at half the capacity");
+    }
+
+    // Reports the event loop's own latency distribution for sessions,
+    // and what recording it costs
+    void
+    statistics()
+    {
+        auto print = [](char const* label, log_histogram const& h)
+        {
+            std::cout << std::left << std::setw(11) << label << ": " << std::right
+                      << std::fixed << std::setprecision(0)
+                      << std::setw(6) << tsc::to_ns(h.percentile(50)) << " ns p50, "
+                      << std::setw(6) << tsc::to_ns(h.percentile(99)) << " ns p99, "
+                      << std::setw(6) << tsc::to_ns(h.percentile(99.9)) << " ns p99.9, ";
+            std::cout << std::setw(8) << tsc::to_ns(h.max()) << " ns max, "
+                      << h.count() << " items\n";
+            std::cout.unsetf(std::ios::floatfield);
+        };
+
+        auto session = [](io_context& ioc, co::tls_stream<co::socket>& tls)
+        {
+            return bench_co(ioc, [&](int& count) -> co::task
+            {
+                co_await co::async_session(tls);
+                ++count;
+            }, N / 100);
+        };
+
+        io_context plain;
+        co::tls_stream<co::socket> plain_tls;
+        auto off = session(plain, plain_tls);
+
+        io_context ioc;
+        ioc.enable_statistics();
+        co::tls_stream<co::socket> tls;
+        auto on = session(ioc, tls);
+
+        print_line(4, "tls_stream", "session", "co", off, on);
+        print_line(4, "tls_stream", "session", "+st", on, off);
+        check_allocs(4, "tls_stream", "session", "+st", on);
+        print("queue wait", ioc.stats()->queue_wait);
+        print("run time", ioc.stats()->run_time);
+    }
+
+    // Returns the CPU the calling thread is running on, or -1 if unknown
+    static int current_cpu() noexcept
+    {
+#if defined(__linux__)
+        return ::sched_getcpu();
+#else
+        return -1;
+#endif
+    }
+
+    // Runs sessions on a fresh thread whose io_context is pinned to
+    // `cpus`, or left to the scheduler when empty. `cpu` receives the
+    // CPU the thread ran its last session on
+    static bench_result bench_pinned(std::vector<unsigned> const& cpus, int& cpu)
+    {
+        bench_result r{};
+        std::thread([&]
+        {
+            io_context ioc;
+            ioc.pin_to(cpus);
+            co::tls_stream<co::socket> tls;
+            r = bench_co(ioc, [&](int& count) -> co::task
+            {
+                co_await co::async_session(tls);
+                ++count;
+                cpu = current_cpu();
+            }, N / 100);
+        }).join();
+        return r;
+    }
+
+    // Compares pinned and unpinned sessions while other threads sweep
+    // memory, competing for CPUs and evicting caches
+    void
+    pinning()
+    {
+        auto order = affinity::spread_order();
+        std::cout << "spread order:";
+        for(unsigned cpu : order)
+            std::cout << " " << cpu;
+        std::cout << "\n";
+
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> load;
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        for(unsigned i = 0; i < threads; ++i)
+            load.emplace_back([&]
+            {
+                // Kept out of the replaced operator new, which GCC misreports here
+                std::size_t const size = 8 << 20;
+                auto* buf = static_cast<unsigned char*>(std::calloc(size, 1));
+                unsigned char x = 0;
+                while(buf && ! stop.load(std::memory_order_relaxed))
+                    for(std::size_t j = 0; j < size; j += 64)
+                        x = static_cast<unsigned char>(x + ++buf[j]);
+                [[maybe_unused]] volatile unsigned char sink = x;
+                std::free(buf);
+            });
+
+        auto fail = [this](char const* what)
+        {
+            std::cout << "FAIL: pinning: " << what << "\n";
+            ++failures;
+        };
+        auto pinned_cpus = affinity::placement::spread().cpus_for(0);
+        for(int i = 0; i < 3; ++i)
+        {
+            int cpu = -1;
+            auto unpinned = bench_pinned({}, cpu);
+            auto pinned = bench_pinned(pinned_cpus, cpu);
+            print_line(4, "tls_stream", "session", "co", unpinned, pinned);
+            print_line(4, "tls_stream", "session", "pin", pinned, unpinned);
+            if(! pinned_cpus.empty() && cpu != static_cast<int>(pinned_cpus.front()))
+                fail("a pinned io_context ran on another CPU");
+        }
+
+        stop = true;
+        for(auto& t : load)
+            t.join();
+
+        // A thread pinned to a node must run on one of its CPUs
+        std::thread([&]
+        {
+            unsigned node = numa::current_node();
+            auto node_cpus = numa::node_cpus(node);
+            if(! numa::pin_thread(node))
+                return;
+            int cpu = current_cpu();
+            if(std::find(node_cpus.begin(), node_cpus.end(),
+                    static_cast<unsigned>(cpu)) == node_cpus.end())
+                fail("a thread pinned to a NUMA node ran off the node");
+        }).join();
+    }
+
+    // Returns sorted delays from a post on this thread until the item
+    // runs on an idle io_context on another thread. `idle_calls`
+    // receives how often the context's idle hook ran before the last
+    // post was done
+    static std::vector<double> bench_wakeup(idle_mode mode, std::chrono::nanoseconds gap,
+        std::size_t& idle_calls)
+    {
+        static constexpr int samples = 2000;
+
+        struct ping : work
+        {
+            std::uint64_t posted_ = 0;
+            std::vector<double> samples_;
+            std::atomic<bool> done_{false};
+
+            void operator()() override
+            {
+                samples_.push_back(tsc::to_ns(tsc::now() - posted_));
+                done_.store(true, std::memory_order_release);
+            }
+        };
+
+        std::atomic<io_context*> pb{nullptr};
+        std::atomic<bool> released{false};
+        std::atomic<std::size_t> calls{0};
+        std::optional<io_context::work_guard> guard;
+        std::thread tb([&]
+        {
+            io_context b;
+            b.set_idle_mode(mode);
+            b.on_idle([](void* arg)
+            {
+                static_cast<std::atomic<std::size_t>*>(arg)->fetch_add(1, std::memory_order_relaxed);
+            }, &calls);
+            guard.emplace(b);
+            pb.store(&b, std::memory_order_release);
+            b.run();
+            while(! released.load(std::memory_order_acquire))
+                std::this_thread::yield();
+        });
+        while(! pb.load(std::memory_order_acquire))
+            std::this_thread::yield();
+        auto ex = pb.load(std::memory_order_acquire)->get_executor();
+
+        ping p;
+        p.samples_.reserve(samples);
+        auto gap_ticks = tsc::from_ns(gap);
+        for(int i = 0; i < samples; ++i)
+        {
+            p.done_.store(false, std::memory_order_relaxed);
+            p.posted_ = tsc::now();
+            ex.post(&p);
+            while(! p.done_.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            // Let the other thread go idle before the next post
+            auto t0 = tsc::now();
+            while(tsc::now() - t0 < gap_ticks)
+                cpu_relax();
+        }
+
+        idle_calls = calls.load(std::memory_order_relaxed);
+        guard.reset();
+        released.store(true, std::memory_order_release);
+        tb.join();
+        std::sort(p.samples_.begin(), p.samples_.end());
+        return std::move(p.samples_);
+    }
+
+#if defined(__linux__)
+    // Returns the delay from a write to a pipe until the operation
+    // waiting on it runs, on a context spinning with a long budget
+    // Returns the ns from a write to the reader running, and in idle the
+    // ns from the loop going idle to the reader running
+    static double bench_spin_poll(std::chrono::nanoseconds budget, double& idle)
+    {
+        using namespace std::chrono_literals;
+
+        struct reader : work
+        {
+            int fd_;
+            std::atomic<std::uint64_t> written_{0};
+            std::uint64_t ran_ = 0;
+
+            void operator()() override
+            {
+                ran_ = tsc::now();
+                char c;
+                [[maybe_unused]] auto r = ::read(fd_, &c, 1);
+            }
+        };
+
+        // Registers the reader from the loop's own thread
+        struct start : work
+        {
+            io_context* ioc_;
+            reader* r_;
+            std::uint64_t ran_ = 0;
+
+            void operator()() override
+            {
+                ioc_->get_executor().post_when_ready(r_, r_->fd_, wait_type::read);
+                ran_ = tsc::now();
+            }
+        };
+
+        int fds[2];
+        if(::pipe(fds) != 0)
+            return 0;
+        io_context ioc;
+        ioc.set_idle_mode(idle_mode::spin, budget);
+        reader r;
+        r.fd_ = fds[0];
+        start s;
+        s.ioc_ = &ioc;
+        s.r_ = &r;
+        ioc.get_executor().post(&s);
+        std::thread writer([&]
+        {
+            std::this_thread::sleep_for(1ms);
+            r.written_.store(tsc::now(), std::memory_order_relaxed);
+            [[maybe_unused]] auto n = ::write(fds[1], "x", 1);
+        });
+        ioc.run();
+        writer.join();
+        ::close(fds[0]);
+        ::close(fds[1]);
+        idle = tsc::to_ns(r.ran_ - s.ran_);
+        return tsc::to_ns(r.ran_ - r.written_.load(std::memory_order_relaxed));
+    }
+#endif
+
+    // Reports cross-thread wake-up latency for each idle mode
+    void
+    wakeup()
+    {
+        using namespace std::chrono_literals;
+        auto fail = [this](char const* what)
+        {
+            std::cout << "FAIL: wakeup: " << what << "\n";
+            ++failures;
+        };
+        std::cout << "cpus " << std::thread::hardware_concurrency() << "\n";
+        for(auto gap : {10us, 200us})
+        {
+            for(auto [mode, name] : {
+                std::pair{idle_mode::block, "block"},
+                std::pair{idle_mode::spin, "spin"},
+                std::pair{idle_mode::adaptive, "adaptive"} })
+            {
+                std::size_t idle_calls = 0;
+                auto v = bench_wakeup(mode, gap, idle_calls);
+                std::cout << std::left << std::setw(9) << name << std::right
+                          << "gap " << std::setw(3) << gap.count() << " us: "
+                          << std::fixed << std::setprecision(0)
+                          << std::setw(7) << v[v.size() / 2] << " ns p50, "
+                          << std::setw(7) << v[v.size() * 99 / 100] << " ns p99, "
+                          << std::setw(5) << idle_calls << " idle calls\n";
+                std::cout.unsetf(std::ios::floatfield);
+                // Each post is drained before the next, so the loop goes
+                // idle once per post, plus once before the first
+                if(idle_calls < v.size() || idle_calls > v.size() + 1)
+                    fail("the idle hook did not run once per idle transition");
+            }
+        }
+#if defined(__linux__)
+        // The loop goes idle right after registering the reader and only
+        // blocks once the whole budget has been spun, so a reader that ran
+        // sooner was found by polling while spinning. Before spinning
+        // polled the waiters, this waited out the budget. The budget is
+        // long so that a slow writer thread cannot outlast it
+        constexpr std::chrono::nanoseconds budget = 5s;
+        double idle = 0;
+        auto d = bench_spin_poll(budget, idle);
+        std::cout << "spin, fd ready: " << std::fixed << std::setprecision(0)
+                  << std::setw(9) << d << " ns\n";
+        std::cout.unsetf(std::ios::floatfield);
+        if(idle >= static_cast<double>(budget.count()))
+            fail("a descriptor became ready while spinning but waited for the budget");
+#endif
+    }
+
+    // Posts `posts` items from this thread to an io_context running on
+    // another, in bursts separated by `gap`, returning posts per second
+    // and the wakeups the loop needed
+    static std::pair<double, std::size_t> bench_wakeups(std::size_t posts, std::size_t burst, std::chrono::nanoseconds gap)
+    {
+        using clock = std::chrono::steady_clock;
+        static constexpr std::size_t pool = 4096;
+
+        struct counted : work
+        {
+            std::atomic<std::size_t>* done_;
+
+            void operator()() override
+            {
+                done_->fetch_add(1, std::memory_order_release);
+            }
+        };
+
+        std::atomic<std::size_t> done{0};
+        auto items = std::make_unique<counted[]>(pool);
+        for(std::size_t i = 0; i < pool; ++i)
+            items[i].done_ = &done;
+
+        std::atomic<io_context*> pb{nullptr};
+        std::atomic<bool> released{false};
+        std::optional<io_context::work_guard> guard;
+        std::size_t wakeups = 0;
+        std::thread tb([&]
+        {
+            io_context b;
+            guard.emplace(b);
+            pb.store(&b, std::memory_order_release);
+            b.run();
+            wakeups = b.wakeups();
+            while(! released.load(std::memory_order_acquire))
+                std::this_thread::yield();
+        });
+        while(! pb.load(std::memory_order_acquire))
+            std::this_thread::yield();
+        auto ex = pb.load(std::memory_order_acquire)->get_executor();
+
+        auto t0 = clock::now();
+        for(std::size_t i = 0; i < posts; ++i)
+        {
+            // An item is reused only after the loop has run it
+            while(i >= pool && done.load(std::memory_order_acquire) <= i - pool)
+                std::this_thread::yield();
+            ex.post(&items[i % pool]);
+            if((i + 1) % burst == 0 && gap.count() > 0)
+            {
+                // Let the loop drain the burst and go back to sleep
+                while(done.load(std::memory_order_acquire) <= i)
+                    std::this_thread::yield();
+                auto t = clock::now();
+                while(clock::now() - t < gap)
+                    cpu_relax();
+            }
+        }
+        while(done.load(std::memory_order_acquire) < posts)
+            std::this_thread::yield();
+        auto t1 = clock::now();
+
+        guard.reset();
+        released.store(true, std::memory_order_release);
+        tb.join();
+        double secs = std::chrono::duration<double>(t1 - t0).count();
+        return { double(posts) / secs, wakeups };
+    }
+
+    // Reports cross-thread post throughput and how many posts needed a wakeup
+    void
+    wakeups()
+    {
+        using namespace std::chrono_literals;
+        auto print = [](char const* label, std::size_t posts, std::pair<double, std::size_t> r)
+        {
+            std::cout << std::left << std::setw(16) << label << ": " << std::right
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(7) << r.first / 1e6 << " Mpost/s, "
+                      << std::setw(8) << std::setprecision(0)
+                      << double(r.second) * 1e6 / double(posts) << " wakeups per 1M posts\n";
+            std::cout.unsetf(std::ios::floatfield);
+        };
+
+        auto check = [this, print](char const* label, std::size_t posts, std::size_t burst,
+            std::chrono::nanoseconds gap)
+        {
+            auto r = bench_wakeups(posts, burst, gap);
+            print(label, posts, r);
+            // A post signals only a sleeping loop, and only the first to
+            // find it asleep. Releasing the work guard wakes it once more
+            bool coalesced = burst > 1 || gap.count() == 0;
+            if(coalesced ? r.second >= posts : r.second > posts + 1)
+            {
+                std::cout << "FAIL: wakeups: " << label << ": "
+                          << r.second << " wakeups for " << posts << " posts\n";
+                ++failures;
+            }
+        };
+        check("stream", 1000000, 1, 0ns);
+        check("bursts of 1", 20000, 1, 20us);
+        check("bursts of 16", 20000 * 16, 16, 20us);
+        check("bursts of 256", 2000 * 256, 256, 20us);
+    }
+
+#if defined(__linux__)
+    // Sends a file over loopback `reps` times, returning wall seconds and
+    // the CPU seconds of the sending thread and of the whole process.
+    // With `verify` the receiver checks every byte against the pattern
+    static std::array<double, 3> bench_send(send_method method, int file,
+        std::size_t size, int reps, bool verify, int& errors)
+    {
+        using clock = std::chrono::steady_clock;
+        auto cpu = [](int who)
+        {
+            rusage ru;
+            ::getrusage(who, &ru);
+            return double(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+                double(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+        };
+
+        int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(listener < 0 || fd < 0 ||
+            ::bind(listener, reinterpret_cast<sockaddr*>(&addr), len) != 0 ||
+            ::listen(listener, 1) != 0 ||
+            ::getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len) != 0 ||
+            ::connect(fd, reinterpret_cast<sockaddr*>(&addr), len) != 0)
+        {
+            ++errors;
+            return {};
+        }
+        int peer = ::accept(listener, nullptr, nullptr);
+        ::close(listener);
+
+        std::size_t const total = size * static_cast<std::size_t>(reps);
+        std::thread receiver([&]
+        {
+            constexpr std::size_t buf_size = 1024 * 1024;
+            auto buf = std::make_unique<unsigned char[]>(buf_size);
+            std::size_t got = 0;
+            while(got < total)
+            {
+                auto n = ::recv(peer, buf.get(), buf_size, 0);
+                if(n <= 0)
+                    break;
+                if(verify)
+                    for(std::size_t i = 0; i < static_cast<std::size_t>(n); ++i)
+                        if(buf[i] != (got + i) % size % 251)
+                        {
+                            ++errors;
+                            break;
+                        }
+                got += static_cast<std::size_t>(n);
+            }
+            if(got != total)
+                ++errors;
+        });
+
+        constexpr std::size_t buf_size = 256 * 1024;
+        auto buf = std::make_unique<char[]>(buf_size);
+        io_context ioc;
+        co::socket sock(fd);
+        double self0 = cpu(RUSAGE_SELF);
+        double thread0 = cpu(RUSAGE_THREAD);
+        auto t0 = clock::now();
+        for(int i = 0; i < reps; ++i)
+        {
+            co::async_run(ioc.get_executor(), send_file(sock, file, size, method, buf.get(), buf_size));
+            ioc.run();
+        }
+        double thread1 = cpu(RUSAGE_THREAD);
+        receiver.join();
+        auto t1 = clock::now();
+        double self1 = cpu(RUSAGE_SELF);
+        ::close(fd);
+        ::close(peer);
+        return { std::chrono::duration<double>(t1 - t0).count(), thread1 - thread0, self1 - self0 };
+    }
+#endif
+
+    // Compares copying a file to a loopback socket through a user buffer
+    // with sendfile and splice, which keep the bytes in the kernel
+    void
+    zero_copy(std::size_t megabytes)
+    {
+#if defined(__linux__)
+        std::size_t const size = megabytes * 1024 * 1024;
+        char path[] = "/tmp/bench_sendfile_XXXXXX";
+        int file = ::mkstemp(path);
+        if(file < 0)
+        {
+            std::cout << "FAIL: sendfile could not create a temporary file\n";
+            ++failures;
+            return;
+        }
+        ::unlink(path);
+        {
+            constexpr std::size_t chunk = 1024 * 1024;
+            auto buf = std::make_unique<char[]>(chunk);
+            for(std::size_t off = 0; off < size; off += chunk)
+            {
+                for(std::size_t i = 0; i < chunk; ++i)
+                    buf[i] = static_cast<char>((off + i) % 251);
+                if(::pwrite(file, buf.get(), chunk, static_cast<off_t>(off)) != static_cast<ssize_t>(chunk))
+                {
+                    std::cout << "FAIL: sendfile could not write the temporary file\n";
+                    ++failures;
+                    ::close(file);
+                    return;
+                }
+            }
+        }
+
+        struct
+        {
+            char const* name;
+            send_method method;
+        } const methods[] = {
+            { "read+write", send_method::copy },
+            { "sendfile", send_method::sendfile },
+            { "splice", send_method::splice },
+        };
+        int const reps = 4;
+        std::cout << megabytes << " MiB file over loopback, " << reps << " passes\n";
+        for(auto const& m : methods)
+        {
+            int errors = 0;
+            bench_send(m.method, file, size, 1, true, errors);
+            auto r = bench_send(m.method, file, size, reps, false, errors);
+            if(errors != 0)
+            {
+                std::cout << "FAIL: " << m.name << " delivered wrong bytes\n";
+                ++failures;
+                continue;
+            }
+            double bytes = double(size) * reps;
+            std::cout << std::left << std::setw(11) << m.name << ": " << std::right
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(6) << bytes / r[0] / 1e9 << " GB/s, sender "
+                      << std::setprecision(3)
+                      << std::setw(6) << r[1] * 1e9 / bytes << " ns cpu/byte, total "
+                      << std::setw(6) << r[2] * 1e9 / bytes << " ns cpu/byte\n";
+            std::cout.unsetf(std::ios::floatfield);
+        }
+        ::close(file);
+#else
+        (void)megabytes;
+        std::cout << "sendfile: requires Linux\n";
+#endif
+    }
+
+#if defined(__linux__)
+    // Returns reads per second with `depth` coroutines reading at once
+    static double bench_file_reads(co::file& f, std::size_t blocks, unsigned depth,
+        std::size_t reads, int& errors)
+    {
+        using clock = std::chrono::steady_clock;
+        auto bufs = std::make_unique<char[]>(std::size_t(depth) * 4096);
+        io_context ioc;
+        std::size_t left = reads;
+        auto t0 = clock::now();
+        for(unsigned i = 0; i < depth; ++i)
+            co::async_run(ioc.get_executor(), random_reads(f, blocks, left,
+                bufs.get() + std::size_t(i) * 4096, 0x9e3779b97f4a7c15ull * (i + 1), errors));
+        ioc.run();
+        auto t1 = clock::now();
+        return double(reads) / std::chrono::duration<double>(t1 - t0).count();
+    }
+#endif
+
+    // Compares random 4 KiB reads through io_uring and the thread pool
+    // fallback at increasing queue depths
+    void
+    files(std::size_t megabytes)
+    {
+#if defined(__linux__)
+        char path[] = "/tmp/bench_file_XXXXXX";
+        int fd = ::mkstemp(path);
+        if(fd < 0)
+        {
+            std::cout << "FAIL: file could not create a temporary file\n";
+            ++failures;
+            return;
+        }
+        ::unlink(path);
+
+        std::size_t const blocks = megabytes * 256;
+        std::size_t const reads = std::max<std::size_t>(blocks, 4096);
+        struct
+        {
+            char const* name;
+            co::file::backend b;
+        } const backends[] = {
+            { "io_uring", co::file::backend::io_uring },
+            { "threads", co::file::backend::thread_pool },
+        };
+        std::cout << megabytes << " MiB file in the page cache, "
+                  << reads << " random 4 KiB reads per depth\n";
+        for(auto const& be : backends)
+        {
+            co::file f(fd, 128, be.b);
+            if(f.get_backend() != be.b)
+            {
+                std::cout << be.name << ": unavailable\n";
+                continue;
+            }
+            int errors = 0;
+            {
+                auto buf = std::make_unique<char[]>(1024 * 1024);
+                io_context ioc;
+                co::async_run(ioc.get_executor(), write_blocks(f, blocks, buf.get(), errors));
+                ioc.run();
+            }
+            for(unsigned depth : { 1u, 4u, 16u, 64u, 128u })
+            {
+                double iops = bench_file_reads(f, blocks, depth, reads, errors);
+                std::cout << std::left << std::setw(8) << be.name << " qd "
+                          << std::setw(3) << depth << ": " << std::right
+                          << std::fixed << std::setprecision(1)
+                          << std::setw(7) << iops / 1e3 << " kIOPS, "
+                          << std::setw(7) << depth / iops * 1e6 << " us latency\n";
+                std::cout.unsetf(std::ios::floatfield);
+            }
+            if(errors != 0)
+            {
+                std::cout << "FAIL: " << be.name << " returned " << errors << " wrong blocks\n";
+                ++failures;
+            }
+        }
+        ::close(fd);
+#else
+        (void)megabytes;
+        std::cout << "file: requires Linux\n";
+#endif
+    }
+
+    // Times back-to-back sessions through one stream. Callback streams
+    // take the executor before the other constructor arguments
+    template<class Stream, class... Args>
+    static bench_result bench_stream_sessions(int sessions, int& done, Args&... args)
+    {
+        using clock = std::chrono::steady_clock;
+        constexpr bool callback = std::is_constructible_v<Stream, io_context::executor, Args&...>;
+        io_context ioc;
+        auto s = [&]
+        {
+            if constexpr(callback)
+                return Stream(ioc.get_executor(), args...);
+            else
+                return Stream(args...);
+        }();
+        g_alloc_count = 0;
+        g_work_count = 0;
+        auto t0 = clock::now();
+        for(int i = 0; i < sessions; ++i)
+        {
+            if constexpr(callback)
+                cb::async_session(s, cb::callback(done));
+            else
+                co::async_run(ioc.get_executor(), counted_session(s, done));
+            ioc.run();
+        }
+        auto t1 = clock::now();
+        return bench_result{ std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() / sessions,
+            g_alloc_count / sessions, 0, g_work_count / sessions };
+    }
+
+    // Compares sessions through a co and a cb stream built from the same
+    // arguments, after an untimed pass of each, so that neither is timed
+    // on the cold caches left by preparing the input
+    template<class CoStream, class CbStream, class... Args>
+    void compare_stream_sessions(char const* stream_type, int sessions, Args&... args)
+    {
+        int co_done = 0;
+        int cb_done = 0;
+        bench_stream_sessions<CoStream>(sessions, co_done, args...);
+        bench_stream_sessions<CbStream>(sessions, cb_done, args...);
+        co_done = 0;
+        cb_done = 0;
+        auto co = bench_stream_sessions<CoStream>(sessions, co_done, args...);
+        auto cb = bench_stream_sessions<CbStream>(sessions, cb_done, args...);
+        auto check = [&](char const* style, int done)
+        {
+            if(done == sessions)
+                return;
+            std::cout << "FAIL: " << stream_type << " " << style << " sessions completed "
+                      << done << " of " << sessions << "\n";
+            ++failures;
+        };
+        check("co", co_done);
+        check("cb", cb_done);
+        print_line(4, stream_type, "session", "cb", cb, co);
+        print_line(4, stream_type, "session", "co", co, cb);
+    }
+
+    // Measures reads from a memory-mapped file in each style against a
+    // plain loop over the mapping
+    void
+    mmap(std::size_t megabytes)
+    {
+#if defined(__linux__)
+        using clock = std::chrono::steady_clock;
+        char path[] = "/tmp/bench_mmap_XXXXXX";
+        int fd = ::mkstemp(path);
+        if(fd < 0)
+        {
+            std::cout << "FAIL: mmap could not create a temporary file\n";
+            ++failures;
+            return;
+        }
+        ::unlink(path);
+        std::size_t const size = megabytes * 1024 * 1024;
+        {
+            constexpr std::size_t chunk = 1024 * 1024;
+            auto buf = std::make_unique<char[]>(chunk);
+            for(std::size_t off = 0; off < size; off += chunk)
+            {
+                for(std::size_t i = 0; i < chunk; ++i)
+                    buf[i] = static_cast<char>((off + i) % 251);
+                if(::pwrite(fd, buf.get(), chunk, static_cast<off_t>(off)) != static_cast<ssize_t>(chunk))
+                {
+                    std::cout << "FAIL: mmap could not write the temporary file\n";
+                    ++failures;
+                    ::close(fd);
+                    return;
+                }
+            }
+        }
+        mapped_file f(fd);
+        ::close(fd);
+
+        auto print = [&](char const* label, double secs, std::size_t works)
+        {
+            std::cout << std::left << std::setw(16) << label << ": " << std::right
+                      << std::fixed << std::setprecision(2)
+                      << std::setw(6) << double(size) / secs / 1e9 << " GB/s, "
+                      << works << " work\n";
+            std::cout.unsetf(std::ios::floatfield);
+        };
+        std::cout << megabytes << " MiB mapped file, 64 KiB reads\n";
+
+        // The first pass faults the mapping in for the others
+        std::uint64_t expected = touch(f.view());
+        auto t0 = clock::now();
+        std::uint64_t sum = touch(f.view());
+        auto t1 = clock::now();
+        print("memory", std::chrono::duration<double>(t1 - t0).count(), 0);
+        auto check_sum = [&](char const* style, std::uint64_t got)
+        {
+            if(got == expected)
+                return;
+            std::cout << "FAIL: mmap " << style << " read the wrong bytes\n";
+            ++failures;
+        };
+        check_sum("memory", sum);
+
+        {
+            io_context ioc;
+            co::mmap_stream s(f, 64 * 1024);
+            std::uint64_t co_sum = 0;
+            g_work_count = 0;
+            t0 = clock::now();
+            co::async_run(ioc.get_executor(), drain(s, co_sum));
+            ioc.run();
+            t1 = clock::now();
+            print("co mmap_stream", std::chrono::duration<double>(t1 - t0).count(), g_work_count);
+            check_sum("co mmap_stream", co_sum);
+        }
+        {
+            io_context ioc;
+            cb::mmap_stream<io_context::executor> s(ioc.get_executor(), f, 64 * 1024);
+            std::uint64_t cb_sum = 0;
+            g_work_count = 0;
+            t0 = clock::now();
+            drain_op<decltype(s)>{ &s, &cb_sum }();
+            ioc.run();
+            t1 = clock::now();
+            print("cb mmap_stream", std::chrono::duration<double>(t1 - t0).count(), g_work_count);
+            check_sum("cb mmap_stream", cb_sum);
+        }
+
+        // Back-to-back sessions of 1000 reads of 4 KiB through the file
+        int const sessions = static_cast<int>(size / (1000 * 4096));
+        if(sessions > 0)
+        {
+            compare_stream_sessions<co::mmap_stream,
+                cb::mmap_stream<io_context::executor>>("mmap", sessions, f);
+        }
+#else
+        (void)megabytes;
+        std::cout << "mmap: requires Linux\n";
+#endif
+    }
+
+    // Replays a synthetic capture through the protocol code in each style,
+    // checks that recording a replay reproduces the capture, and keeps
+    // the original timing for part of it
+    void
+    replay(std::size_t records)
+    {
+#if defined(__linux__)
+        using clock = std::chrono::steady_clock;
+        char path[] = "/tmp/bench_trace_XXXXXX";
+        char copy_path[] = "/tmp/bench_trace_XXXXXX";
+        int fd = ::mkstemp(path);
+        int copy_fd = ::mkstemp(copy_path);
+        if(fd < 0 || copy_fd < 0)
+        {
+            std::cout << "FAIL: replay could not create temporary files\n";
+            ++failures;
+            return;
+        }
+        ::close(fd);
+        ::close(copy_fd);
+
+        // Mostly small reads with a tail of large ones, 1 to 100 us apart,
+        // and some which yielded nothing
+        std::chrono::nanoseconds recorded{0};
+        std::chrono::nanoseconds paced_recorded{0};
+        // One session's worth of reads is replayed with the original timing
+        int const paced = static_cast<int>(std::min<std::size_t>(records, 1000));
+        {
+            trace::writer w(path);
+            auto buf = std::make_unique<char[]>(16384);
+            for(std::size_t i = 0; i < 16384; ++i)
+                buf[i] = static_cast<char>(i % 251);
+            std::uint64_t x = 0x9e3779b97f4a7c15ull;
+            for(std::size_t i = 0; i < records; ++i)
+            {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                std::size_t size = x % 100 < 5 ? 0 : x % 100 < 70 ? 1 + x % 512
+                    : x % 100 < 95 ? 512 + x % 3584 : 4096 + x % 12288;
+                std::chrono::nanoseconds delay(1000 + static_cast<long long>(x >> 40) % 99000);
+                w.record(delay, { buf.get() + i % 251, std::min<std::size_t>(size, 16384 - 251) });
+                recorded += delay;
+                if(i < static_cast<std::size_t>(paced))
+                    paced_recorded += delay;
+            }
+        }
+        mapped_file capture(path);
+        // Fault the capture in so neither style pays for it
+        volatile std::uint64_t sink = touch(capture.view());
+        (void)sink;
+        std::cout << records << " records, " << capture.view().size() / 1024
+                  << " KiB, " << recorded.count() / 1000000 << " ms as recorded\n";
+
+        // Full speed: back-to-back sessions of 1000 reads through the capture
+        int const sessions = static_cast<int>(records / 1000);
+        if(sessions > 0)
+        {
+            compare_stream_sessions<co::replay_stream,
+                cb::replay_stream<io_context::executor>>("replay", sessions, capture);
+        }
+
+        // A recording of a replay holds the same bytes in the same reads,
+        // including the empty ones, and nothing for the end of the trace
+        {
+            std::size_t reads = 0;
+            {
+                trace::writer w(copy_path);
+                io_context ioc;
+                co::recording_stream<co::replay_stream> s(w, capture);
+                co::async_run(ioc.get_executor(), copy_all(s, reads));
+                ioc.run();
+            }
+            mapped_file copy(copy_path);
+            trace::reader a(capture);
+            trace::reader b(copy);
+            trace::record ra, rb;
+            bool same = reads == records && b.size() == a.size();
+            while(same && a.next(ra))
+                same = b.next(rb) && ra.bytes == rb.bytes;
+            if(! same)
+            {
+                std::cout << "FAIL: recording a replay changed the trace\n";
+                ++failures;
+            }
+        }
+
+        // Original timing: the replay must not run ahead of the capture
+        auto check_paced = [&](char const* name, std::chrono::nanoseconds took)
+        {
+            std::cout << name << " original timing: " << paced << " reads recorded over "
+                      << paced_recorded.count() / 1000 << " us, replayed in "
+                      << took.count() / 1000 << " us, "
+                      << (took - paced_recorded).count() / 1000 << " us late\n";
+            if(took < paced_recorded)
+            {
+                std::cout << "FAIL: " << name << " replay ran ahead of the recorded timing\n";
+                ++failures;
+            }
+        };
+        {
+            io_context ioc;
+            co::replay_stream s(capture, trace::timing::original);
+            auto t0 = clock::now();
+            co::async_run(ioc.get_executor(), replay_reads(s, paced));
+            ioc.run();
+            check_paced("co", clock::now() - t0);
+        }
+        if(paced == 1000)
+        {
+            io_context ioc;
+            cb::replay_stream<io_context::executor> s(
+                ioc.get_executor(), capture, trace::timing::original);
+            int done = 0;
+            auto t0 = clock::now();
+            cb::async_session(s, cb::callback(done));
+            ioc.run();
+            check_paced("cb", clock::now() - t0);
+        }
+        ::unlink(path);
+        ::unlink(copy_path);
+#else
+        (void)records;
+        std::cout << "replay: requires Linux\n";
+#endif
+    }
+
+    // Runs sessions on threads pinned to cpu_node whose frames live on
+    // mem_node, counting threads that ended up anywhere else in misplaced
+    static long long bench_numa(unsigned cpu_node, unsigned mem_node, unsigned threads,
+        std::atomic<unsigned>& misplaced)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        static constexpr int sessions = 1000;
+        std::atomic<unsigned> ready{0};
+        std::atomic<long long> total{0};
+
+        std::vector<std::thread> v;
+        for(unsigned i = 0; i < threads; ++i)
+        {
+            v.emplace_back([&]
+            {
+                // Allocate the socket and warm the frame pool on mem_node,
+                // then move to cpu_node keeping the memory where it is
+                numa::bind_thread(mem_node);
+                io_context ioc;
+                co::socket sock;
+                int count = 0;
+                co::async_run(ioc.get_executor(), co::async_session(sock));
+                ioc.run();
+                bool pinned = numa::pin_thread(cpu_node);
+
+                // The memory node stays put while the thread moves
+                if(numa::thread_node() != mem_node ||
+                    (pinned && numa::current_node() != cpu_node))
+                    misplaced.fetch_add(1);
+
+                ready.fetch_add(1);
+                while(ready.load() < threads)
+                    std::this_thread::yield();
+
+                auto t0 = clock::now();
+                for(int j = 0; j < sessions; ++j)
+                {
+                    co::async_run(ioc.get_executor(), co::async_session(sock));
+                    ioc.run();
+                    ++count;
+                }
+                auto t1 = clock::now();
+                total.fetch_add(std::chrono::duration_cast<
+                    std::chrono::nanoseconds>(t1 - t0).count() / count);
+            });
+        }
+        for(auto& t : v)
+            t.join();
+        return total.load() / threads;
+    }
+
+    // Compares the multi-threaded session scenario within and across NUMA nodes
+    void
+    numa_nodes()
+    {
+        unsigned nodes = numa::node_count();
+        std::cout << "numa: " << nodes << " node(s)\n";
+        for(unsigned cpu = 0; cpu < nodes; ++cpu)
+        {
+            auto cpus = numa::node_cpus(cpu).size();
+            unsigned threads = static_cast<unsigned>(
+                std::clamp<std::size_t>(cpus, 1, 4));
+            for(unsigned mem = 0; mem < nodes; ++mem)
+            {
+                std::atomic<unsigned> misplaced{0};
+                auto ns = bench_numa(cpu, mem, threads, misplaced);
+                std::cout << "4 socket     session    "
+                          << (cpu == mem ? "within" : "across")
+                          << " cpu node " << cpu << " mem node " << mem << ": "
+                          << std::setw(5) << ns << " ns/op, "
+                          << threads << " threads\n";
+                if(misplaced.load() != 0)
+                {
+                    std::cout << "FAIL: " << misplaced.load() << " thread(s) not on cpu node "
+                              << cpu << " with mem node " << mem << "\n";
+                    ++failures;
+                }
+            }
+        }
+    }
+
+    // Runs `sessions` concurrent sessions on a fresh thread so that the
+    // frame pool starts empty, returning ns and dTLB misses per session
+    static std::pair<long long, long long> bench_sessions(int sessions, bool huge)
+    {
+        using clock = std::chrono::high_resolution_clock;
+        std::pair<long long, long long> r;
+        std::thread t([&]
+        {
+            co::detail::frame_pool::use_huge_pages(huge);
+            io_context ioc;
+            std::vector<co::socket> socks(static_cast<std::size_t>(sessions));
+            auto tlb = perf_counter::dtlb_load_misses();
+
+            tlb.start();
+            auto t0 = clock::now();
+            for(auto& sock : socks)
+                co::async_run(ioc.get_executor(), co::async_session(sock));
+            ioc.run();
+            auto t1 = clock::now();
+            long long misses = tlb.stop();
+
+            r.first = std::chrono::duration_cast<
+                std::chrono::nanoseconds>(t1 - t0).count() / sessions;
+            r.second = misses < 0 ? -1 : misses / sessions;
+            co::detail::frame_pool::use_huge_pages(false);
+        });
+        t.join();
+        return r;
+    }
+
+    // Compares heap and huge-page slab refills with many live sessions
+    void
+    huge_pages(int sessions)
+    {
+        auto print = [](char const* style, std::pair<long long, long long> r)
+        {
+            std::cout << "4 socket     session    " << style << ": "
+                      << std::setw(5) << r.first << " ns/op, ";
+            if(r.second < 0)
+                std::cout << "n/a dTLB-misses/op\n";
+            else
+                std::cout << r.second << " dTLB-misses/op\n";
+        };
+
+        auto& regions = co::detail::huge_region::count();
+        auto& huge = co::detail::huge_region::huge_count();
+        std::cout << "hugepages: " << sessions << " concurrent sessions\n";
+        auto before = regions.load();
+        print("heap", bench_sessions(sessions, false));
+        auto heap_regions = regions.load() - before;
+        print("huge", bench_sessions(sessions, true));
+        std::cout << regions.load() << " regions mapped, "
+                  << huge.load() << " with MADV_HUGEPAGE\n";
+
+        // The kernel may refuse the advice, but the regions must be used
+        if(heap_regions != 0)
+        {
+            std::cout << "FAIL: heap refills mapped " << heap_regions << " regions\n";
+            ++failures;
+        }
+#if defined(__linux__)
+        if(regions.load() == before)
+        {
+            std::cout << "FAIL: huge-page refills mapped no regions\n";
+            ++failures;
+        }
+#endif
+    }
+
+    static void print_pool(char const* label)
+    {
+        using pool = co::detail::frame_pool;
+        auto print = [](char const* name, pool::stats const& st)
+        {
+            std::cout << "    " << std::left << std::setw(7) << name << std::right
+                      << std::setw(7) << st.blocks << " blocks, "
+                      << std::setw(9) << st.bytes << " bytes, "
+                      << st.hits << " hits, " << st.misses << " misses\n";
+        };
+        std::cout << label << "\n";
+        print("local", pool::local_stats());
+        print("global", pool::global_stats());
+    }
+
+    // Shows the frame pools growing during a burst of sessions and
+    // shrinking when the io_context goes idle with a trim hook installed
+    void
+    pool()
+    {
+        using pool = co::detail::frame_pool;
+        static constexpr std::size_t keep_bytes = 64 * 1024;
+        auto fail = [this](char const* what)
+        {
+            std::cout << "FAIL: pool: " << what << "\n";
+            ++failures;
+        };
+        std::thread t([&]
+        {
+            io_context ioc;
+            std::vector<co::socket> socks(1000);
+
+            for(auto& sock : socks)
+                co::async_run(ioc.get_executor(), co::async_session(sock));
+            ioc.run();
+            print_pool("after 1000 concurrent sessions:");
+
+            auto burst = pool::local_stats();
+            if(burst.bytes <= keep_bytes)
+                fail("the burst cached no more than the trim keeps");
+
+            pool::limits keep;
+            keep.local_bytes = keep_bytes;
+            keep.global_bytes = 0;
+            pool::trim_on_idle(ioc, &keep);
+            co::async_run(ioc.get_executor(), co::async_session(socks[0]));
+            ioc.run();
+            ioc.on_idle(nullptr, nullptr);
+            print_pool("after 1 session with trim_on_idle(64 KiB):");
+            if(pool::local_stats().bytes > keep_bytes || pool::global_stats().bytes != 0)
+                fail("trim_on_idle left more cached than its limits");
+
+            std::size_t released = pool::trim();
+            print_pool("after trim():");
+            std::cout << "    released " << released << " bytes\n";
+            if(pool::local_stats().bytes != 0)
+                fail("trim() left blocks in the local pool");
+        });
+        t.join();
+    }
+
+    void
+    run()
+    {
+        io_context ioc;
+        auto ex = ioc.get_executor();
+        cb::socket<io_context::executor> cb_sock(ex);
+        co::socket co_sock;
+        cb::tls_stream<cb::socket<io_context::executor>> cb_tls(ex);
+        co::tls_stream<co::socket> co_tls;
+        cb::any_stream any_sock(cb_sock);
+        cb::any_stream any_tls(cb_tls);
+        sr::socket<io_context::executor> sr_sock(ex);
+        sr::tls_stream<sr::socket<io_context::executor>> sr_tls(ex);
+
+        bench_result cb, co, sr, any;
+
+        // socket read_some (1 call) - level 1
+        cb = bench(cb_sock, [](auto& sock, auto h){ sock.async_read_some(std::move(h)); });
+        co = bench_co(ioc, [&](int& count) -> co::task { co_await co_sock.async_read_some(); ++count; });
+        sr = bench_sr(ioc, [&]{ return sr_sock.async_read_some(); });
+        any = bench(any_sock, [](auto& sock, auto h){ sock.async_read_some(std::move(h)); });
+        print_results(1, "socket", "read_some", cb, co, sr, any);
+
+        // tls_stream read_some (1 call) - level 1
+        cb = bench(cb_tls, [](auto& sock, auto h){ sock.async_read_some(std::move(h)); });
+        co = bench_co(ioc, [&](int& count) -> co::task { co_await co_tls.async_read_some(); ++count; });
+        sr = bench_sr(ioc, [&]{ return sr_tls.async_read_some(); });
+        any = bench(any_tls, [](auto& sock, auto h){ sock.async_read_some(std::move(h)); });
+        print_results(1, "tls_stream", "read_some", cb, co, sr, any);
+
+        std::cout << "\n";
+
+        // socket read (5 calls) - level 2
+        cb = bench(cb_sock, [](auto& sock, auto h){ cb::async_read(sock, std::move(h)); });
+        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_read(co_sock); ++count; });
+        sr = bench_sr(ioc, [&]{ return sr::async_read(sr_sock); });
+        any = bench(any_sock, [](auto& sock, auto h){ cb::async_read(sock, std::move(h)); });
+        print_results(2, "socket", "read", cb, co, sr, any);
+
+        // tls_stream read (5 calls) - level 2
+        cb = bench(cb_tls, [](auto& sock, auto h){ cb::async_read(sock, std::move(h)); });
+        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_read(co_tls); ++count; });
+        sr = bench_sr(ioc, [&]{ return sr::async_read(sr_tls); });
+        any = bench(any_tls, [](auto& sock, auto h){ cb::async_read(sock, std::move(h)); });
+        print_results(2, "tls_stream", "read", cb, co, sr, any);
+
+        std::cout << "\n";
+
+        // socket request (10 calls) - level 2
+        cb = bench(cb_sock, [](auto& sock, auto h){ cb::async_request(sock, std::move(h)); });
+        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_request(co_sock); ++count; });
+        sr = bench_sr(ioc, [&]{ return sr::async_request(sr_sock); });
+        any = bench(any_sock, [](auto& sock, auto h){ cb::async_request(sock, std::move(h)); });
+        print_results(3, "socket", "request", cb, co, sr, any);
+
+        // tls_stream request (10 calls) - level 2
+        cb = bench(cb_tls, [](auto& sock, auto h){ cb::async_request(sock, std::move(h)); });
+        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_request(co_tls); ++count; });
+        sr = bench_sr(ioc, [&]{ return sr::async_request(sr_tls); });
+        any = bench(any_tls, [](auto& sock, auto h){ cb::async_request(sock, std::move(h)); });
+        print_results(3, "tls_stream", "request", cb, co, sr, any);
+
+        std::cout << "\n";
+
+        // socket session (1000 calls) - level 3
+        cb = bench(cb_sock, [](auto& sock, auto h){ cb::async_session(sock, std::move(h)); });
+        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_session(co_sock); ++count; });
+        sr = bench_sr(ioc, [&]{ return sr::async_session(sr_sock); });
+        any = bench(any_sock, [](auto& sock, auto h){ cb::async_session(sock, std::move(h)); });
+        print_results(4, "socket", "session", cb, co, sr, any);
+
+        // tls_stream session (1000 calls) - level 3
+        cb = bench(cb_tls, [](auto& sock, auto h){ cb::async_session(sock, std::move(h)); });
+        co = bench_co(ioc, [&](int& count) -> co::task { co_await co::async_session(co_tls); ++count; });
+        sr = bench_sr(ioc, [&]{ return sr::async_session(sr_tls); });
+        any = bench(any_tls, [](auto& sock, auto h){ cb::async_session(sock, std::move(h)); });
+        print_results(4, "tls_stream", "session", cb, co, sr, any);
+
+        abandoned();
+    }
+};
+
+// Parses a whole number from min through max into n, returning false
+// for anything else
+static bool parse_number(char const* arg, long min, long max, long& n) noexcept
+{
+    char* end = nullptr;
+    errno = 0;
+    long v = std::strtol(arg, &end, 10);
+    if(end == arg || *end != '\0' || errno != 0 || v < min || v > max)
+        return false;
+    n = v;
+    return true;
+}
+
+// Parses a count argument, returning 0 unless it is a whole number
+// from 1 through max
+static long parse_count(char const* arg, long max) noexcept
+{
+    long n = 0;
+    return parse_number(arg, 1, max, n) ? n : 0;
+}
+
+int main(int argc, char** argv)
+{
+    bench_test t;
+    if(argc > 1 && std::strcmp(argv[1], "--frames") == 0)
+    {
+        t.frames();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--numa") == 0)
+    {
+        t.numa_nodes();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--handler-sizes") == 0)
+    {
+        t.handler_sizes();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--spawn") == 0)
+    {
+        t.spawn();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--fanout") == 0)
+    {
+        t.fanout();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--cold") == 0)
+    {
+        t.cold_start();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--hop") == 0)
+    {
+        t.hop();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--priority") == 0)
+    {
+        t.priorities();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--overload") == 0)
+    {
+        t.overload();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--stats") == 0)
+    {
+        t.statistics();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--pinning") == 0)
+    {
+        t.pinning();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--wakeup") == 0)
+    {
+        t.wakeup();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--wakeups") == 0)
+    {
+        t.wakeups();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--sendfile") == 0)
+    {
+        // --sendfile [megabytes]
+        long megabytes = argc > 2 ? parse_count(argv[2], LONG_MAX >> 20) : 64;
+        if(megabytes == 0)
+        {
+            std::cerr << "usage: bench --sendfile [megabytes(1 or more)]\n";
+            return 2;
+        }
+        t.zero_copy(static_cast<std::size_t>(megabytes));
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--file") == 0)
+    {
+        // --file [megabytes]
+        long megabytes = argc > 2 ? parse_count(argv[2], LONG_MAX >> 20) : 64;
+        if(megabytes == 0)
+        {
+            std::cerr << "usage: bench --file [megabytes(1 or more)]\n";
+            return 2;
+        }
+        t.files(static_cast<std::size_t>(megabytes));
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--mmap") == 0)
+    {
+        // --mmap [megabytes]
+        long megabytes = argc > 2 ? parse_count(argv[2], LONG_MAX >> 20) : 256;
+        if(megabytes == 0)
+        {
+            std::cerr << "usage: bench --mmap [megabytes(1 or more)]\n";
+            return 2;
+        }
+        t.mmap(static_cast<std::size_t>(megabytes));
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--replay") == 0)
+    {
+        // --replay [records]
+        long records = argc > 2 ? parse_count(argv[2], LONG_MAX) : 20000;
+        if(records == 0)
+        {
+            std::cerr << "usage: bench --replay [records(1 or more)]\n";
+            return 2;
+        }
+        t.replay(static_cast<std::size_t>(records));
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--shape") == 0)
+    {
+        // --shape [depth [fanout [state [work]]]]; no arguments runs a sweep
+        if(argc == 2)
+        {
+            t.shapes();
+            return t.failures == 0 ? 0 : 1;
+        }
+        workload_shape shape;
+        long depth = 0;
+        long fanout = shape.fanout;
+        long state = 0;
+        long work = shape.work;
+        if(! parse_number(argv[2], 1, workload_shape::max_depth, depth) ||
+            (argc > 3 && ! parse_number(argv[3], 1, INT_MAX, fanout)) ||
+            (argc > 4 && ! parse_number(argv[4], 0, LONG_MAX, state)) ||
+            (argc > 5 && ! parse_number(argv[5], 0, INT_MAX, work)) ||
+            ! workload_shape::valid_state(static_cast<std::size_t>(state)))
+        {
+            std::cerr << "usage: bench --shape [depth(1-" << workload_shape::max_depth
+                      << ") [fanout [state(0, 64, 256 or 1024) [work]]]]\n";
+            return 2;
+        }
+        shape.depth = static_cast<int>(depth);
+        shape.fanout = static_cast<int>(fanout);
+        shape.state = static_cast<std::size_t>(state);
+        shape.work = static_cast<int>(work);
+        t.bench_shape(shape);
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--pool") == 0)
+    {
+        t.pool();
+        return t.failures == 0 ? 0 : 1;
+    }
+    if(argc > 1 && std::strcmp(argv[1], "--hugepages") == 0)
+    {
+        // --hugepages [sessions]
+        long sessions = argc > 2 ? parse_count(argv[2], INT_MAX) : 100000;
+        if(sessions == 0)
+        {
+            std::cerr << "usage: bench --hugepages [sessions(1 or more)]\n";
+            return 2;
+        }
+        t.huge_pages(static_cast<int>(sessions));
+        return t.failures == 0 ? 0 : 1;
+    }
     t.run();
-    return 0;
+    return t.failures == 0 ? 0 : 1;
 }
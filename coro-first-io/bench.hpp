@@ -10,18 +10,58 @@
 #ifndef BENCH_HPP
 #define BENCH_HPP
 
+#include "bench_affinity.hpp"
+#include "bench_numa.hpp"
+#include "bench_stats.hpp"
+
+#include <atomic>
+#include <chrono>
 #include <concepts>
 #include <coroutine>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
 
-// Global counters for benchmark fairness verification
-extern std::size_t g_io_count;
-extern std::size_t g_work_count;
+// Per-thread counters for benchmark fairness verification
+extern thread_local constinit std::size_t g_io_count;
+extern thread_local constinit std::size_t g_work_count;
 
 using coro = std::coroutine_handle<void>;
 
+// Returns a value unique to the calling thread, cheaper than std::this_thread::get_id
+inline void const* this_thread_token() noexcept
+{
+    static thread_local constinit char token = 0;
+    return &token;
+}
+
+// Tells the CPU the caller is spinning, easing contention with its sibling thread
+inline void cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
 struct work_queue;
+struct remote_queue;
+struct io_context;
 
 /** Abstract base class for executable work items.
 
@@ -33,6 +73,11 @@ struct work_queue;
     Derived classes must implement `operator()` to define the work
     to be performed when the item is executed.
 
+    A queue destroyed with items still in it releases each one with
+    `destroy()` instead of running it. The default deletes the item;
+    items that live elsewhere, such as in a coroutine frame, in an
+    awaitable, or in memory from a handler's allocator, override it.
+
     @note Work items are typically allocated with custom allocators
     (such as op_cache or frame_pool) to minimize allocation overhead
     in high-frequency async operations.
@@ -44,9 +89,18 @@ struct work
     virtual ~work() = default;
     virtual void operator()() = 0;
 
+    // Releases an item that will never run
+    virtual void destroy() noexcept
+    {
+        delete this;
+    }
+
 private:
     friend struct work_queue;
+    friend struct remote_queue;
+    friend struct io_context;
     work* next_ = nullptr;
+    std::uint64_t enqueued_ = 0;
 };
 
 /** An intrusive FIFO queue of work items.
@@ -55,8 +109,8 @@ private:
     avoiding additional allocations for queue nodes. Work items are
     executed in the order they were pushed (first-in, first-out).
 
-    The queue takes ownership of pushed work items and will delete
-    any remaining items when destroyed.
+    The queue takes ownership of pushed work items and releases any
+    remaining items with `work::destroy` when destroyed.
 
     @note This is not thread-safe. External synchronization is required
     for concurrent access.
@@ -71,7 +125,7 @@ struct work_queue
         {
             auto p = head_;
             head_ = head_->next_;
-            delete p;
+            p->destroy();
         }
     }
 
@@ -79,6 +133,8 @@ struct work_queue
 
     void push(work* p)
     {
+        // Work items are reused, so clear any link left from a previous pass
+        p->next_ = nullptr;
         if(tail_)
         {
             tail_->next_ = p;
@@ -89,6 +145,20 @@ struct work_queue
         tail_ = p;
     }
 
+    // Moves every item of other to the back of this queue
+    void splice(work_queue& other) noexcept
+    {
+        if(! other.head_)
+            return;
+        if(tail_)
+            tail_->next_ = other.head_;
+        else
+            head_ = other.head_;
+        tail_ = other.tail_;
+        other.head_ = nullptr;
+        other.tail_ = nullptr;
+    }
+
     work* pop()
     {
         if(head_)
@@ -107,6 +177,113 @@ private:
     work* tail_ = nullptr;
 };
 
+/** An intrusive queue of work items that any thread may push to.
+
+    Pushes are a lock-free compare-and-swap onto a stack; the single
+    consumer takes the whole stack at once and restores FIFO order.
+
+    @see work_queue
+*/
+struct remote_queue
+{
+    remote_queue() = default;
+    remote_queue(remote_queue const&) = delete;
+    remote_queue& operator=(remote_queue const&) = delete;
+
+    // Releases items that were never taken, like work_queue
+    ~remote_queue()
+    {
+        work* p = head_.load(std::memory_order_acquire);
+        while(p)
+        {
+            auto next = p->next_;
+            p->destroy();
+            p = next;
+        }
+    }
+
+    // Returns true if the queue was empty
+    bool push(work* p) noexcept
+    {
+        auto head = head_.load(std::memory_order_relaxed);
+        do
+        {
+            p->next_ = head;
+        }
+        while(! head_.compare_exchange_weak(head, p,
+            std::memory_order_seq_cst, std::memory_order_relaxed));
+        return head == nullptr;
+    }
+
+    // Sequentially consistent, like push, so that a consumer going to
+    // sleep and a producer checking whether it sleeps cannot both miss
+    bool empty() const noexcept
+    {
+        return head_.load(std::memory_order_seq_cst) == nullptr;
+    }
+
+    // Pushes a whole batch with one compare-and-swap, keeping its order;
+    // returns true if the queue was empty
+    bool push(work_queue& batch) noexcept
+    {
+        // Link the batch newest first, as single pushes would leave it
+        work* newest = nullptr;
+        work* oldest = nullptr;
+        while(work* p = batch.pop())
+        {
+            p->next_ = newest;
+            newest = p;
+            if(! oldest)
+                oldest = p;
+        }
+        if(! newest)
+            return false;
+        auto head = head_.load(std::memory_order_relaxed);
+        do
+        {
+            oldest->next_ = head;
+        }
+        while(! head_.compare_exchange_weak(head, newest,
+            std::memory_order_seq_cst, std::memory_order_relaxed));
+        return head == nullptr;
+    }
+
+    // Moves every item to the back of q, oldest first
+    void take(work_queue& q) noexcept
+    {
+        if(empty())
+            return;
+        work* p = head_.exchange(nullptr, std::memory_order_acquire);
+        work* reversed = nullptr;
+        while(p)
+        {
+            auto next = p->next_;
+            p->next_ = reversed;
+            reversed = p;
+            p = next;
+        }
+        while(reversed)
+        {
+            auto next = reversed->next_;
+            q.push(reversed);
+            reversed = next;
+        }
+    }
+
+private:
+    std::atomic<work*> head_{nullptr};
+};
+
+/** What a readiness wait on a native descriptor waits for.
+
+    @see any_executor::post_when_ready
+*/
+enum class wait_type
+{
+    read,
+    write
+};
+
 /** Abstract base class for executors.
 
     Executors provide the interface for dispatching coroutines and posting
@@ -120,6 +297,105 @@ struct any_executor
     virtual ~any_executor() = default;
     virtual coro dispatch(coro h) const = 0;
     virtual void post(work* w) const = 0;
+
+    // Identifies where work runs; executors with equal contexts are interchangeable
+    virtual void const* context() const noexcept
+    {
+        return this;
+    }
+
+    /** Posts a work item once a native descriptor is ready.
+
+        Operations on non-blocking descriptors call this when a system
+        call would block. It returns `false` if the executor has no
+        reactor, in which case the caller retries some other way, such
+        as by posting the item.
+    */
+    virtual bool post_when_ready(work*, int, wait_type) const
+    {
+        return false;
+    }
+};
+
+/** A CoDel controller which detects a standing queue.
+
+    Controlled Delay watches the sojourn time of each item leaving a
+    queue, the time from enqueue to dequeue. A burst that drains within
+    one interval is tolerated; when every item for a whole interval has
+    waited longer than the target, the queue is standing and the
+    controller reports overload until an item is dequeued under the
+    target. An idle queue clears it with the next item.
+
+    Work items cannot be dropped the way packets are, so instead of
+    CoDel's drop schedule the overload state is exposed for producers
+    such as accept loops to shed new requests.
+
+    @see io_context::enable_admission_control
+*/
+class codel
+{
+    std::uint64_t target_;
+    std::uint64_t interval_;
+    std::uint64_t first_above_ = 0;
+    std::atomic<bool> overloaded_{false};
+
+public:
+    codel(std::chrono::nanoseconds target, std::chrono::nanoseconds interval) noexcept
+        : target_(tsc::from_ns(target))
+        , interval_(tsc::from_ns(interval))
+    {
+    }
+
+    // Called for each dequeued item, with times in tsc ticks
+    void on_dequeue(std::uint64_t sojourn, std::uint64_t now) noexcept
+    {
+        if(sojourn < target_)
+        {
+            first_above_ = 0;
+            overloaded_.store(false, std::memory_order_relaxed);
+            return;
+        }
+        if(first_above_ == 0)
+            first_above_ = now + interval_;
+        else if(now >= first_above_)
+            overloaded_.store(true, std::memory_order_relaxed);
+    }
+
+    bool overloaded() const noexcept
+    {
+        return overloaded_.load(std::memory_order_relaxed);
+    }
+};
+
+/** The lane of an io_context that an executor posts to.
+
+    Control-plane work such as health checks, timer expiry and
+    cancellation goes in the high lane so it is not queued behind bulk
+    data work in the low lane.
+
+    @see io_context::get_executor
+*/
+enum class priority : unsigned char
+{
+    high,
+    normal,
+    low
+};
+
+/** What `io_context::run` does when it runs out of work.
+
+    @see io_context::set_idle_mode
+*/
+enum class idle_mode : unsigned char
+{
+    // Block in the kernel until another thread posts
+    block,
+
+    // Spin for the whole budget before blocking
+    spin,
+
+    // Spin for about twice the recent idle time, if that fits the budget
+    adaptive
 };
 
 /** A simple I/O context for running asynchronous operations.
@@ -140,6 +416,56 @@ struct any_executor
     ioc.run();  // Process all queued work
     @endcode
 
+    @par Priority Lanes
+    Work is queued in one of three lanes chosen by the executor it is
+    posted through. `run()` always takes the next item from the highest
+    non-empty lane. With a starvation limit set, a non-empty lower lane
+    that has been passed over for that many consecutive items runs
+    next, so the lanes share the loop in a weighted ratio instead of
+    strictly. Posts from other threads join their lanes at least every
+    `remote_interval` items, so they compete with local work under the
+    same rules instead of waiting for the local lanes to drain.
+
+    @par Admission Control
+    After `enable_admission_control`, each post stamps the item and
+    `run()` feeds its sojourn time to a CoDel controller. Producers
+    query `overloaded()` to shed load before the queue grows further.
+
+    @par Statistics
+    After `enable_statistics`, `run()` also records how long each item
+    waited in the queue and how long it ran, in log histograms of tsc
+    ticks. Timestamps cost one `tsc::now()` per post and one per item
+    run, since the end of one item is the dequeue time of the next.
+
+    @par Idle Modes
+    When only other threads can supply work, `run()` normally blocks
+    until one posts. Waking a blocked thread costs microseconds, so
+    `set_idle_mode` can make it spin on the remote queues with `pause`
+    first. In adaptive mode the spin budget follows a moving average of
+    recent idle periods: short gaps between arrivals are spun through
+    and long ones go straight to sleep.
+
+    @par Thread Safety
+    The context is owned by the thread that constructed it, until
+    another thread calls `run()`, and then by the thread that last
+    called `run()`. Posts from the owner go to a plain queue, even
+    between calls to `run()`, so a thread that posts and runs in turn
+    never pays for synchronization. Posts from any other thread go to
+    a lock-free remote queue and wake the owner if it is waiting.
+    `run()` returns once both queues are empty and no `work_guard` is
+    outstanding.
+
+    A thread that builds a context for another thread to run, and
+    keeps posting to it afterwards, calls `release()` before handing
+    it over. From then on its posts take the remote queue, so the two
+    threads never touch the plain queue together.
+
+    A waiting owner sets an atomic sleeping flag and blocks reading an
+    eventfd, which a reactor would add to its poll set. A remote post
+    writes to the eventfd only if it finds the queue empty and claims
+    the flag, so a burst of posts costs one wakeup system call and
+    posts to a running loop cost none.
+
     @note This is a simplified implementation for benchmarking purposes.
     Production implementations would integrate with OS-level async I/O.
 
@@ -149,12 +475,19 @@ struct any_executor
 */
 struct io_context
 {
+    static constexpr std::size_t lanes = 3;
+
+    // Items run between checks of the remote queues while local work remains
+    static constexpr unsigned remote_interval = 64;
+
     struct executor : any_executor
     {
         io_context* ctx_;
+        priority pri_ = priority::normal;
 
         executor() : ctx_(nullptr) {}
-        executor(io_context* ctx) : ctx_(ctx) {}
+        executor(io_context* ctx, priority pri = priority::normal)
+            : ctx_(ctx), pri_(pri) {}
 
         // For coroutines: return handle for symmetric transfer
         coro dispatch(coro h) const override
@@ -172,28 +505,562 @@ struct io_context
 
         void post(work* w) const override
         {
-            ctx_->q_.push(w);
+            if(ctx_->stamp_)
+                w->enqueued_ = tsc::now();
+            auto lane = static_cast<std::size_t>(pri_);
+            if(ctx_->owner_.load(std::memory_order_relaxed) == this_thread_token())
+                ctx_->q_[lane].push(w);
+            else
+                ctx_->post_remote(w, lane);
         }
 
+        // Posts a whole batch in one operation
+        void post(work_queue& batch) const
+        {
+            auto lane = static_cast<std::size_t>(pri_);
+            if(ctx_->owner_.load(std::memory_order_relaxed) == this_thread_token())
+            {
+                if(ctx_->stamp_)
+                    ctx_->stamp(batch);
+                ctx_->q_[lane].splice(batch);
+                return;
+            }
+            if(ctx_->stamp_)
+                ctx_->stamp(batch);
+            if(ctx_->remote_[lane].push(batch))
+                ctx_->wake();
+        }
+
+        // Each lane is a separate place for work to run, so executors
+        // for different lanes of one context are not interchangeable
+        void const* context() const noexcept override
+        {
+            return &ctx_->q_[static_cast<std::size_t>(pri_)];
+        }
+
+#if defined(__linux__)
+        // Only the running thread polls, so waits from elsewhere are refused
+        bool post_when_ready(work* w, int fd, wait_type wait) const override
+        {
+            if(ctx_->owner_.load(std::memory_order_relaxed) != this_thread_token())
+                return false;
+            ctx_->waiters_.push_back({ w, fd,
+                wait == wait_type::read ? short(POLLIN) : short(POLLOUT),
+                static_cast<std::size_t>(pri_) });
+            return true;
+        }
+#endif
+
         bool operator==(executor const& other) const noexcept
         {
-            return ctx_ == other.ctx_;
+            return ctx_ == other.ctx_ && pri_ == other.pri_;
         }
     };
 
-    executor get_executor() { return {this}; }
+    io_context() = default;
+    io_context(io_context const&) = delete;
+    io_context& operator=(io_context const&) = delete;
+
+    ~io_context()
+    {
+#if defined(__linux__)
+        for(auto const& w : waiters_)
+            w.w->destroy();
+        if(event_fd_ >= 0)
+            ::close(event_fd_);
+#endif
+    }
+
+    executor get_executor(priority pri = priority::normal)
+    {
+        return {this, pri};
+    }
+
+    /** Keeps `run()` from returning while work is expected from other threads.
+    */
+    class work_guard
+    {
+        io_context* ctx_;
+
+    public:
+        explicit work_guard(io_context& ctx) noexcept
+            : ctx_(&ctx)
+        {
+            ctx_->outstanding_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        work_guard(work_guard const&) = delete;
+        work_guard& operator=(work_guard const&) = delete;
+
+        ~work_guard()
+        {
+            if(ctx_->outstanding_.fetch_sub(1, std::memory_order_seq_cst) == 1)
+                ctx_->wake();
+        }
+    };
+
+    /** Pins the threads that call `run()` to a NUMA node.
+
+        Each such thread is restricted to the CPUs of the node, and
+        the coroutine frames it allocates come from the node's slabs.
+        A thread is bound the first time it runs the context.
+
+        @see numa::bind_thread
+    */
+    void bind_to_node(unsigned node) noexcept
+    {
+        node_ = node;
+        has_node_ = true;
+        bound_thread_ = nullptr;
+    }
+
+    /** Pins the threads that call `run()` to a set of CPUs.
+
+        Keeping an event loop on one core keeps its coroutine frames
+        and work items warm in that core's caches. A thread is pinned
+        the first time it runs the context; pass an empty set to stop
+        pinning threads that have not run it yet.
+
+        @see affinity::placement
+    */
+    void pin_to(std::vector<unsigned> cpus)
+    {
+        cpus_ = std::move(cpus);
+        pinned_thread_ = nullptr;
+    }
+
+    /** Returns how many times another thread has woken `run()`.
+
+        Each is one system call; posts that find the loop awake or
+        already being woken are not counted.
+    */
+    std::size_t wakeups() const noexcept
+    {
+        return wakeups_.load(std::memory_order_relaxed);
+    }
+
+    /** Sets how `run()` waits for work from other threads.
+
+        @param mode Whether to block at once, spin, or spin adaptively.
+        @param budget The longest spin before blocking.
+    */
+    void set_idle_mode(idle_mode mode,
+        std::chrono::nanoseconds budget = std::chrono::microseconds(50))
+    {
+        idle_mode_ = mode;
+        spin_budget_ = mode == idle_mode::block ? 0 : tsc::from_ns(budget);
+        idle_average_ = 0;
+    }
+
+    /** Sets how many consecutive items a non-empty lane may be passed over.
+
+        Zero, the default, gives strict priority: a lower lane runs only
+        when every higher lane is empty.
+    */
+    void set_starvation_limit(unsigned n) noexcept
+    {
+        starvation_limit_ = n;
+    }
+
+    /** Tracks sojourn times and reports a standing queue as overload.
+
+        Call before posting work. The defaults are CoDel's, suited to
+        request latencies in milliseconds.
+
+        @param target The sojourn time the queue should stay under.
+        @param interval How long sojourn must stay above the target.
+
+        @see overloaded
+    */
+    void enable_admission_control(
+        std::chrono::nanoseconds target = std::chrono::milliseconds(5),
+        std::chrono::nanoseconds interval = std::chrono::milliseconds(100))
+    {
+        codel_.emplace(target, interval);
+        stamp_ = true;
+    }
+
+    /** Returns true while admission control sees a standing queue.
+
+        Accept loops and callers of `async_run` check this to refuse
+        new work early. It is always false unless admission control is
+        enabled.
+    */
+    bool overloaded() const noexcept
+    {
+        return codel_ && codel_->overloaded();
+    }
+
+    /** Histograms of the work run by this context, in tsc ticks.
+
+        Each context is run by one thread at a time, so these are the
+        per-thread histograms; merge them across contexts to report
+        on a whole server.
+
+        @see tsc::to_ns
+    */
+    struct statistics
+    {
+        log_histogram queue_wait;
+        log_histogram run_time;
+    };
+
+    /** Records queue-wait and run-time histograms from now on.
+
+        Call before posting work that should be measured.
+    */
+    void enable_statistics()
+    {
+        if(! stats_)
+            stats_ = std::make_unique<statistics>();
+        tsc::ns_per_tick();
+        stamp_ = true;
+    }
+
+    /** Returns the recorded histograms, or null if not enabled.
+    */
+    statistics* stats() noexcept
+    {
+        return stats_.get();
+    }
+
+    /** Sets a function to call each time `run()` runs out of work.
+
+        The hook runs on the thread that called `run()`, once each time
+        the loop goes from running work to idle: before it spins or
+        blocks waiting for more, or before `run()` returns. It is meant
+        for housekeeping such as trimming caches; work it posts runs
+        before the loop goes idle. Pass `nullptr` to remove it.
+    */
+    void on_idle(void (*fn)(void*), void* arg) noexcept
+    {
+        idle_fn_ = fn;
+        idle_arg_ = arg;
+    }
+
+    /** Gives up the calling thread's ownership.
+
+        Until a thread calls `run()`, every post goes through the
+        remote queue. Call this on the owning thread before another
+        thread runs the context while this one may still post.
+    */
+    void release() noexcept
+    {
+        owner_.store(nullptr, std::memory_order_relaxed);
+    }
 
     void run()
     {
-        while(!q_.empty())
+        if(has_node_ && bound_thread_ != this_thread_token())
         {
-            ++g_work_count;
-            (*q_.pop())();
+            numa::bind_thread(node_);
+            bound_thread_ = this_thread_token();
+        }
+        if(! cpus_.empty() && pinned_thread_ != this_thread_token())
+        {
+            affinity::pin_this_thread(cpus_);
+            pinned_thread_ = this_thread_token();
+        }
+        // Only this thread can see its own token, so relaxed suffices
+        owner_.store(this_thread_token(), std::memory_order_relaxed);
+        bool notified = false;
+        for(;;)
+        {
+            if(stamp_)
+                run_stamped();
+            else
+            {
+                while(work* w = next())
+                {
+                    ++g_work_count;
+                    (*w)();
+                }
+            }
+            bool any = take_remote();
+#if defined(__linux__)
+            if(! waiters_.empty())
+                any = poll_waiters(0) || any;
+#endif
+            if(any)
+            {
+                notified = false;
+                continue;
+            }
+            if(idle_fn_ && ! notified)
+            {
+                notified = true;
+                idle_fn_(idle_arg_);
+                continue;
+            }
+            if(outstanding_.load(std::memory_order_acquire) == 0 && ! waiting())
+                break;
+            idle();
         }
     }
 
 private:
-    work_queue q_;
+    // Moves cross-thread posts into their lanes, returning true if any lane has work
+    bool take_remote() noexcept
+    {
+        bool any = false;
+        for(std::size_t i = 0; i < lanes; ++i)
+        {
+            remote_[i].take(q_[i]);
+            any = any || ! q_[i].empty();
+        }
+        return any;
+    }
+
+    // Pops from the highest non-empty lane, unless a lower one is starved
+    work* next() noexcept
+    {
+        if(++since_remote_ == remote_interval)
+        {
+            since_remote_ = 0;
+            take_remote();
+        }
+        std::size_t lane = 0;
+        while(q_[lane].empty())
+            if(++lane == lanes)
+                return nullptr;
+        if(starvation_limit_ != 0)
+        {
+            for(std::size_t i = lane + 1; i < lanes; ++i)
+            {
+                if(q_[i].empty())
+                    continue;
+                if(++skipped_[i] > starvation_limit_)
+                {
+                    lane = i;
+                    break;
+                }
+            }
+            skipped_[lane] = 0;
+        }
+        return q_[lane].pop();
+    }
+
+    // Like the plain loop in run(), feeding admission control and statistics
+    void run_stamped()
+    {
+        auto t = tsc::now();
+        while(work* w = next())
+        {
+            ++g_work_count;
+            // Another core's counter may be slightly ahead
+            auto wait = t > w->enqueued_ ? t - w->enqueued_ : 0;
+            if(codel_)
+                codel_->on_dequeue(wait, t);
+            if(stats_)
+                stats_->queue_wait.record(wait);
+            (*w)();
+            auto done = tsc::now();
+            if(stats_)
+                stats_->run_time.record(done - t);
+            t = done;
+        }
+    }
+
+    void stamp(work_queue& batch) noexcept
+    {
+        auto t = tsc::now();
+        work_queue stamped;
+        while(auto* w = batch.pop())
+        {
+            w->enqueued_ = t;
+            stamped.push(w);
+        }
+        batch.splice(stamped);
+    }
+
+    void post_remote(work* w, std::size_t lane)
+    {
+        if(remote_[lane].push(w))
+            wake();
+    }
+
+    // Wakes the owner if it is sleeping and nobody else has woken it yet
+    void wake() noexcept
+    {
+        if(! sleeping_.load(std::memory_order_seq_cst) ||
+            ! sleeping_.exchange(false, std::memory_order_acq_rel))
+            return;
+        wakeups_.fetch_add(1, std::memory_order_relaxed);
+#if defined(__linux__)
+        std::uint64_t one = 1;
+        [[maybe_unused]] auto n = ::write(event_fd_, &one, sizeof(one));
+#else
+        signal_.fetch_add(1, std::memory_order_release);
+        signal_.notify_one();
+#endif
+    }
+
+    // True while operations wait for descriptors to become ready
+    bool waiting() const noexcept
+    {
+#if defined(__linux__)
+        return ! waiters_.empty();
+#else
+        return false;
+#endif
+    }
+
+#if defined(__linux__)
+    // Polls the descriptors operations wait on, and the eventfd too when
+    // blocking, then queues the items whose descriptors are ready
+    bool poll_waiters(int timeout)
+    {
+        pollfds_.clear();
+        for(auto const& w : waiters_)
+            pollfds_.push_back({ w.fd, w.events, 0 });
+        if(timeout != 0)
+            pollfds_.push_back({ event_fd_, POLLIN, 0 });
+        if(::poll(pollfds_.data(), pollfds_.size(), timeout) <= 0)
+            return false;
+        if(timeout != 0 && pollfds_.back().revents != 0)
+        {
+            std::uint64_t n;
+            [[maybe_unused]] auto r = ::read(event_fd_, &n, sizeof(n));
+        }
+        bool any = false;
+        std::size_t kept = 0;
+        for(std::size_t i = 0; i < waiters_.size(); ++i)
+        {
+            // Errors and hangups are ready too; the retried call reports them
+            if(pollfds_[i].revents == 0)
+            {
+                waiters_[kept++] = waiters_[i];
+                continue;
+            }
+            if(stamp_)
+                waiters_[i].w->enqueued_ = tsc::now();
+            q_[waiters_[i].lane].push(waiters_[i].w);
+            any = true;
+        }
+        waiters_.resize(kept);
+        return any;
+    }
+#endif
+
+    bool has_remote() const noexcept
+    {
+        for(auto const& r : remote_)
+            if(! r.empty())
+                return true;
+        return false;
+    }
+
+    // Spins and then blocks, as the idle mode says. Spinning also
+    // polls the descriptors operations wait on
+    void idle()
+    {
+        if(idle_mode_ == idle_mode::block)
+        {
+            wait();
+            return;
+        }
+        auto start = tsc::now();
+        auto budget = spin_budget_;
+        if(idle_mode_ == idle_mode::adaptive)
+            budget = idle_average_ < spin_budget_ / 2 ? 2 * idle_average_ : 0;
+        auto t = start;
+        while(t - start < budget)
+        {
+            if(has_remote() || (outstanding_.load(std::memory_order_acquire) == 0 && ! waiting()))
+                break;
+#if defined(__linux__)
+            if(! waiters_.empty() && poll_waiters(0))
+                break;
+#endif
+            cpu_relax();
+            t = tsc::now();
+        }
+        if(t - start >= budget)
+        {
+            wait();
+            t = tsc::now();
+        }
+        // Exponential moving average with weight 1/8
+        auto d = t - start;
+        idle_average_ = idle_average_ - idle_average_ / 8 + d / 8;
+    }
+
+    // Blocks until another thread posts, a guard is released or a
+    // descriptor an operation waits on is ready
+    void wait()
+    {
+#if defined(__linux__)
+        if(event_fd_ < 0)
+        {
+            event_fd_ = ::eventfd(0, EFD_CLOEXEC);
+            if(event_fd_ < 0)
+            {
+                std::this_thread::yield();
+                return;
+            }
+        }
+#else
+        auto seen = signal_.load(std::memory_order_acquire);
+#endif
+        // Also publishes the eventfd to the thread that claims the flag
+        sleeping_.store(true, std::memory_order_seq_cst);
+        if(has_remote() || (outstanding_.load(std::memory_order_seq_cst) == 0 && ! waiting()))
+        {
+            // A waker that already claimed the flag leaves a spurious wakeup
+            sleeping_.store(false, std::memory_order_relaxed);
+            return;
+        }
+#if defined(__linux__)
+        if(! waiters_.empty())
+        {
+            poll_waiters(-1);
+            sleeping_.store(false, std::memory_order_relaxed);
+            return;
+        }
+        std::uint64_t n;
+        [[maybe_unused]] auto r = ::read(event_fd_, &n, sizeof(n));
+#else
+        signal_.wait(seen, std::memory_order_acquire);
+#endif
+    }
+
+    work_queue q_[lanes];
+    remote_queue remote_[lanes];
+    unsigned skipped_[lanes] = {};
+    unsigned starvation_limit_ = 0;
+    unsigned since_remote_ = 0;
+    std::optional<codel> codel_;
+    std::unique_ptr<statistics> stats_;
+    bool stamp_ = false;
+    idle_mode idle_mode_ = idle_mode::block;
+    std::uint64_t spin_budget_ = 0;
+    std::uint64_t idle_average_ = 0;
+    std::atomic<void const*> owner_{this_thread_token()};
+    std::atomic<std::size_t> outstanding_{0};
+    std::atomic<bool> sleeping_{false};
+    std::atomic<std::size_t> wakeups_{0};
+#if defined(__linux__)
+    struct waiter
+    {
+        work* w;
+        int fd;
+        short events;
+        std::size_t lane;
+    };
+
+    int event_fd_ = -1;
+    std::vector<waiter> waiters_;
+    std::vector<pollfd> pollfds_;
+#else
+    std::atomic<unsigned> signal_{0};
+#endif
+    void (*idle_fn_)(void*) = nullptr;
+    void* idle_arg_ = nullptr;
+    unsigned node_ = 0;
+    bool has_node_ = false;
+    void const* bound_thread_ = nullptr;
+    std::vector<unsigned> cpus_;
+    void const* pinned_thread_ = nullptr;
 };
 
 #endif
@@ -0,0 +1,238 @@
+//
+// Copyright (c) 2025 Vinnie Falco (vinnie dot falco at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/cppalliance/wg21-papers/coro-first-io
+//
+
+#ifndef BENCH_AFFINITY_HPP
+#define BENCH_AFFINITY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/** CPU topology and thread pinning without external libraries.
+
+    On Linux the topology is read from sysfs and threads are pinned
+    with `pthread_setaffinity_np`. On other platforms no CPUs are
+    reported and pinning is a no-op that returns `false`.
+*/
+namespace affinity {
+
+namespace detail {
+
+// Parses a sysfs list such as "0-3,8-11" into its members
+inline std::vector<unsigned> parse_list(std::string const& s)
+{
+    std::vector<unsigned> v;
+    std::size_t i = 0;
+    while(i < s.size())
+    {
+        std::size_t end;
+        unsigned lo = static_cast<unsigned>(std::stoul(s.substr(i), &end));
+        unsigned hi = lo;
+        i += end;
+        if(i < s.size() && s[i] == '-')
+        {
+            ++i;
+            hi = static_cast<unsigned>(std::stoul(s.substr(i), &end));
+            i += end;
+        }
+        for(unsigned n = lo; n <= hi; ++n)
+            v.push_back(n);
+        while(i < s.size() && (s[i] == ',' || s[i] == '\n'))
+            ++i;
+    }
+    return v;
+}
+
+inline std::vector<unsigned> read_list(char const* path)
+{
+    std::ifstream f(path);
+    std::string s;
+    if(! std::getline(f, s) || s.empty())
+        return {};
+    return parse_list(s);
+}
+
+inline int read_int(std::string const& path, int fallback)
+{
+    std::ifstream f(path);
+    int v;
+    if(f >> v)
+        return v;
+    return fallback;
+}
+
+#if defined(__linux__)
+inline bool set_affinity(pthread_t t, std::vector<unsigned> const& cpus)
+{
+    if(cpus.empty())
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(unsigned cpu : cpus)
+        if(cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    return ::pthread_setaffinity_np(t, sizeof(set), &set) == 0;
+}
+#endif
+
+} // detail
+
+/** Returns the online CPUs, or an empty list if unknown.
+*/
+inline std::vector<unsigned> online_cpus()
+{
+    return detail::read_list("/sys/devices/system/cpu/online");
+}
+
+/** Returns the online CPUs with physical cores before SMT siblings.
+
+    The first hardware thread of every core comes first, ordered by
+    package and core, then the second thread of every core, and so
+    on. Assigning threads in this order gives each one a core of its
+    own for as long as there are cores to go around.
+*/
+inline std::vector<unsigned> spread_order()
+{
+    // (sibling rank, package, core, cpu)
+    std::vector<std::tuple<unsigned, int, int, unsigned>> v;
+    for(unsigned cpu : online_cpus())
+    {
+        std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        auto siblings = detail::read_list((dir + "thread_siblings_list").c_str());
+        auto it = std::find(siblings.begin(), siblings.end(), cpu);
+        unsigned rank = it == siblings.end() ? 0 : static_cast<unsigned>(it - siblings.begin());
+        v.emplace_back(rank,
+            detail::read_int(dir + "physical_package_id", 0),
+            detail::read_int(dir + "core_id", static_cast<int>(cpu)),
+            cpu);
+    }
+    std::sort(v.begin(), v.end());
+    std::vector<unsigned> cpus;
+    cpus.reserve(v.size());
+    for(auto const& e : v)
+        cpus.push_back(std::get<3>(e));
+    return cpus;
+}
+
+/** Restricts the calling thread to a set of CPUs.
+
+    @return `true` if the thread's CPU affinity was changed.
+*/
+inline bool pin_this_thread(std::vector<unsigned> const& cpus)
+{
+#if defined(__linux__)
+    return detail::set_affinity(::pthread_self(), cpus);
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+/** Restricts a thread to a set of CPUs.
+
+    @return `true` if the thread's CPU affinity was changed.
+*/
+inline bool pin_thread(std::thread& t, std::vector<unsigned> const& cpus)
+{
+#if defined(__linux__)
+    return detail::set_affinity(t.native_handle(), cpus);
+#else
+    (void)t;
+    (void)cpus;
+    return false;
+#endif
+}
+
+/** Where each thread of a group should run.
+
+    A placement maps a thread's index in its group, such as a worker
+    number, to the CPUs it may run on.
+
+    @par Example
+    @code
+    auto p = affinity::placement::spread();
+    for(std::size_t i = 0; i < n; ++i)
+        threads.emplace_back([&, i]
+        {
+            io_context ioc;
+            ioc.pin_to(p.cpus_for(i));
+            ...
+        });
+    @endcode
+*/
+class placement
+{
+    std::vector<unsigned> cpus_;
+    bool shared_ = false;
+
+    placement(std::vector<unsigned> cpus, bool shared)
+        : cpus_(std::move(cpus)), shared_(shared) {}
+
+public:
+    /** Leaves threads where the scheduler puts them.
+    */
+    placement() = default;
+
+    /** Pins thread `i` to `cpus[i % cpus.size()]`.
+    */
+    static placement cpus(std::vector<unsigned> cpus)
+    {
+        return { std::move(cpus), false };
+    }
+
+    /** Lets every thread run on any CPU of the set.
+    */
+    static placement cpu_set(std::vector<unsigned> cpus)
+    {
+        return { std::move(cpus), true };
+    }
+
+    /** Pins one thread per CPU, physical cores before SMT siblings.
+
+        @see spread_order
+    */
+    static placement spread()
+    {
+        return { spread_order(), false };
+    }
+
+    /** Returns the CPUs thread `i` may run on, empty for anywhere.
+    */
+    std::vector<unsigned> cpus_for(std::size_t i) const
+    {
+        if(cpus_.empty() || shared_)
+            return cpus_;
+        return { cpus_[i % cpus_.size()] };
+    }
+
+    /** Pins the calling thread as thread `i` of the group.
+
+        @return `true` if the thread's CPU affinity was changed.
+    */
+    bool apply(std::size_t i) const
+    {
+        if(cpus_.empty())
+            return false;
+        return pin_this_thread(cpus_for(i));
+    }
+};
+
+} // affinity
+
+#endif
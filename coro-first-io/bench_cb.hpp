@@ -15,6 +15,9 @@
 
 #include <utility>
 #include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
 
 namespace cb {
 
@@ -62,6 +65,34 @@ struct callback
 static_assert(sizeof(callback) == memfn_size, 
     "callback size must match member function pointer size");
 
+/** A callback padded to a given size.
+
+    Used to measure how the cost of moving handlers through composed
+    operations scales with the size of the user's handler.
+
+    @tparam Size The size of the handler in bytes.
+*/
+template<std::size_t Size>
+struct sized_callback
+{
+    static_assert(Size >= sizeof(int*),
+        "handler must be able to hold a pointer");
+
+    int* count_ptr_;
+    std::byte padding_[Size - sizeof(int*)];
+
+    explicit sized_callback(int& count) noexcept
+        : count_ptr_(&count)
+        , padding_{}
+    {
+    }
+
+    void operator()() const noexcept
+    {
+        ++(*count_ptr_);
+    }
+};
+
 //----------------------------------------------------------
 
 /** A simulated asynchronous socket for benchmarking callback-based I/O.
@@ -94,12 +125,37 @@ struct socket
     {
         ++g_io_count;
         using op_t = detail::io_op<Executor, std::decay_t<Handler>>;
-        ex_.post(new op_t(ex_, std::forward<Handler>(handler)));
+        auto alloc = get_associated_allocator(handler);
+        void* p = alloc.allocate(sizeof(op_t));
+        ex_.post(::new(p) op_t(ex_, std::forward<Handler>(handler)));
     }
 };
 
 //----------------------------------------------------------
 
+/** Tag selecting the stable-state mode of a composed operation.
+
+    By default each step of a composed operation moves the whole op,
+    including the nested handler, into the next `io_op`, so the cost of
+    a step grows with handler size and nesting depth. In stable-state
+    mode the op is allocated once per operation with the handler's
+    associated allocator, stays at a fixed address, and each step moves
+    only a pointer-sized reference to it.
+
+    @par Example
+    @code
+    cb::async_session(sock, cb::stable, handler);
+    @endcode
+*/
+struct stable_t
+{
+    explicit stable_t() = default;
+};
+
+inline constexpr stable_t stable{};
+
+//----------------------------------------------------------
+
 /** A TLS stream adapter that wraps another stream.
 
     This class wraps a stream and provides an async_read_some
@@ -124,6 +180,291 @@ struct tls_stream
     {
         detail::tls_read_op<Stream, std::decay_t<Handler>>(stream_, std::forward<Handler>(handler))();
     }
+
+    /** Reads in stable-state mode.
+
+        The stable composed operations already hand this stream a
+        pointer-sized handler, so they call the moving overload; this
+        one is for callers reading the stream directly.
+
+        @see stable_t
+    */
+    template<class Handler>
+    void async_read_some(stable_t, Handler&& handler)
+    {
+        detail::start_stable<detail::stable_tls_read_op<Stream, std::decay_t<Handler>>>(
+            stream_, std::forward<Handler>(handler));
+    }
+};
+
+//----------------------------------------------------------
+
+/** A type-erased completion handler.
+
+    Holds any move-only callable taking no arguments. Handlers up to
+    `buffer_size` bytes are stored in place; larger ones are placed in
+    a block recycled through a thread-local cache, which is released
+    before the handler is invoked so the continuation can reuse it.
+
+    The wrapped handler's associated allocator is forwarded through
+    the vtable, so operations carrying an `any_handler` allocate the
+    same way they would for the handler itself.
+
+    @see any_stream
+*/
+class any_handler
+{
+public:
+    static constexpr std::size_t buffer_size = 4 * sizeof(void*);
+
+private:
+    struct vtable
+    {
+        void (*invoke)(any_handler&);
+        void (*move)(any_handler& dst, any_handler& src) noexcept;
+        void (*destroy)(any_handler&) noexcept;
+        void* (*allocate)(any_handler const&, std::size_t);
+        void (*deallocate)(any_handler const&, void*, std::size_t) noexcept;
+    };
+
+    template<class Handler>
+    static constexpr bool is_small =
+        sizeof(Handler) <= buffer_size &&
+        alignof(Handler) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<Handler>;
+
+    using cache = detail::op_cache<any_handler>;
+
+    template<class Handler>
+    struct small_ops
+    {
+        static Handler& get(any_handler& a) noexcept
+        {
+            return *std::launder(reinterpret_cast<Handler*>(a.buf_));
+        }
+
+        static Handler const& get(any_handler const& a) noexcept
+        {
+            return *std::launder(reinterpret_cast<Handler const*>(a.buf_));
+        }
+
+        static void invoke(any_handler& a)
+        {
+            get(a)();
+        }
+
+        static void move(any_handler& dst, any_handler& src) noexcept
+        {
+            ::new(dst.buf_) Handler(std::move(get(src)));
+            get(src).~Handler();
+        }
+
+        static void destroy(any_handler& a) noexcept
+        {
+            get(a).~Handler();
+        }
+
+        static void* allocate(any_handler const& a, std::size_t n)
+        {
+            return get_associated_allocator(get(a)).allocate(n);
+        }
+
+        static void deallocate(any_handler const& a, void* p, std::size_t n) noexcept
+        {
+            get_associated_allocator(get(a)).deallocate(p, n);
+        }
+
+        static constexpr vtable table{
+            &invoke, &move, &destroy, &allocate, &deallocate };
+    };
+
+    template<class Handler>
+    struct large_ops
+    {
+        static Handler*& get(any_handler& a) noexcept
+        {
+            return *std::launder(reinterpret_cast<Handler**>(a.buf_));
+        }
+
+        static Handler const& get(any_handler const& a) noexcept
+        {
+            return **std::launder(reinterpret_cast<Handler* const*>(a.buf_));
+        }
+
+        static void invoke(any_handler& a)
+        {
+            // Free the block before the upcall so the handler can reuse it
+            Handler* p = std::exchange(get(a), nullptr);
+            Handler h(std::move(*p));
+            p->~Handler();
+            cache::deallocate(p, sizeof(Handler));
+            a.vt_ = nullptr;
+            h();
+        }
+
+        static void move(any_handler& dst, any_handler& src) noexcept
+        {
+            ::new(dst.buf_) Handler*(std::exchange(get(src), nullptr));
+        }
+
+        static void destroy(any_handler& a) noexcept
+        {
+            if(Handler* p = get(a))
+            {
+                p->~Handler();
+                cache::deallocate(p, sizeof(Handler));
+            }
+        }
+
+        static void* allocate(any_handler const& a, std::size_t n)
+        {
+            return get_associated_allocator(get(a)).allocate(n);
+        }
+
+        static void deallocate(any_handler const& a, void* p, std::size_t n) noexcept
+        {
+            get_associated_allocator(get(a)).deallocate(p, n);
+        }
+
+        static constexpr vtable table{
+            &invoke, &move, &destroy, &allocate, &deallocate };
+    };
+
+    vtable const* vt_ = nullptr;
+    alignas(std::max_align_t) unsigned char buf_[buffer_size];
+
+public:
+    // Forwards to the associated allocator of the wrapped handler
+    struct allocator
+    {
+        any_handler const* h_;
+
+        void* allocate(std::size_t n) const
+        {
+            return h_->vt_->allocate(*h_, n);
+        }
+
+        void deallocate(void* p, std::size_t n) const noexcept
+        {
+            h_->vt_->deallocate(*h_, p, n);
+        }
+    };
+
+    any_handler() = default;
+
+    template<class Handler>
+        requires (!std::same_as<std::decay_t<Handler>, any_handler>)
+    any_handler(Handler&& h)
+    {
+        using H = std::decay_t<Handler>;
+        if constexpr(is_small<H>)
+        {
+            ::new(buf_) H(std::forward<Handler>(h));
+            vt_ = &small_ops<H>::table;
+        }
+        else
+        {
+            void* p = cache::allocate(sizeof(H));
+            ::new(buf_) H*(::new(p) H(std::forward<Handler>(h)));
+            vt_ = &large_ops<H>::table;
+        }
+    }
+
+    any_handler(any_handler&& other) noexcept
+        : vt_(other.vt_)
+    {
+        if(vt_)
+            vt_->move(*this, other);
+        other.vt_ = nullptr;
+    }
+
+    any_handler& operator=(any_handler&&) = delete;
+
+    ~any_handler()
+    {
+        if(vt_)
+            vt_->destroy(*this);
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return vt_ != nullptr;
+    }
+
+    allocator get_allocator() const noexcept
+    {
+        return { this };
+    }
+
+    void operator()()
+    {
+        vt_->invoke(*this);
+    }
+};
+
+//----------------------------------------------------------
+
+/** A type-erased stream.
+
+    Wraps a reference to any stream with an `async_read_some` taking a
+    handler, so that code on the other side of an ABI boundary can use
+    it without being a template. Every handler passed through is
+    converted to an `any_handler`, and every call is an indirect call.
+    The stream's executor must be an `io_context::executor`.
+
+    Composed operations such as `async_read` accept an `any_stream`
+    like any other stream, so each level of composition above it is
+    templated and each level below it is erased.
+
+    @par Example
+    @code
+    cb::tls_stream<cb::socket<io_context::executor>> tls(ex);
+    cb::any_stream s(tls);
+    cb::async_request(s, handler);
+    @endcode
+
+    @see any_handler
+*/
+class any_stream
+{
+    struct impl
+    {
+        virtual ~impl() = default;
+        virtual void async_read_some(any_handler h) = 0;
+    };
+
+    template<class Stream>
+    struct impl_t final : impl
+    {
+        Stream* s_;
+
+        explicit impl_t(Stream& s) : s_(&s) {}
+
+        void async_read_some(any_handler h) override
+        {
+            s_->async_read_some(std::move(h));
+        }
+    };
+
+    std::unique_ptr<impl> impl_;
+    io_context::executor ex_;
+
+public:
+    template<class Stream>
+        requires (!std::same_as<Stream, any_stream>)
+    explicit any_stream(Stream& s)
+        : impl_(new impl_t<Stream>(s))
+        , ex_(s.get_executor())
+    {
+    }
+
+    io_context::executor get_executor() const { return ex_; }
+
+    template<class Handler>
+    void async_read_some(Handler&& handler)
+    {
+        impl_->async_read_some(any_handler(std::forward<Handler>(handler)));
+    }
 };
 
 //----------------------------------------------------------
@@ -187,6 +528,47 @@ void async_session(Stream& stream, Handler&& handler)
     detail::session_op<Stream, std::decay_t<Handler>>(stream, std::forward<Handler>(handler))();
 }
 
+//----------------------------------------------------------
+
+/** Performs a composed read operation in stable-state mode.
+
+    @see async_read
+    @see stable_t
+*/
+template<class Stream, class Handler>
+void async_read(Stream& stream, stable_t, Handler&& handler)
+{
+    detail::start_stable<detail::stable_read_op<Stream, std::decay_t<Handler>>>(
+        stream, std::forward<Handler>(handler));
+}
+
+/** Performs a composed request operation in stable-state mode.
+
+    @see async_request
+    @see stable_t
+*/
+template<class Stream, class Handler>
+void async_request(Stream& stream, stable_t, Handler&& handler)
+{
+    detail::start_stable<detail::stable_request_op<Stream, std::decay_t<Handler>>>(
+        stream, std::forward<Handler>(handler));
+}
+
+/** Performs a composed session operation in stable-state mode.
+
+    The session's state embeds the memory for the request it has in
+    flight, so steady-state sessions do not allocate per request.
+
+    @see async_session
+    @see stable_t
+*/
+template<class Stream, class Handler>
+void async_session(Stream& stream, stable_t, Handler&& handler)
+{
+    detail::start_stable<detail::stable_session_op<Stream, std::decay_t<Handler>>>(
+        stream, std::forward<Handler>(handler));
+}
+
 //----------------------------------------------------------
 // Deferred definitions for detail ops that call free functions
 
@@ -209,9 +591,21 @@ void detail::session_op<Stream, Handler>::operator()()
         async_request(*stream_, std::move(*this));
         return;
     }
+    free_memory(handler_, release_memory());
     handler_();
 }
 
+template<class Stream, class Handler>
+void detail::stable_session_op<Stream, Handler>::resume()
+{
+    if(count_++ < 100)
+    {
+        async_request(*stream_, stable, stable_ref<stable_session_op>{this});
+        return;
+    }
+    complete_stable(this);
+}
+
 } // cb
 
 #endif
@@ -13,12 +13,16 @@
 #include "bench.hpp"
 
 #include <cstddef>
+#include <new>
 #include <utility>
 
 namespace cb {
+
 namespace detail {
 
-// Thread-local cache for operation recycling
+// Thread-local cache for operation recycling; each Tag has its own
+// slot so memory of different kinds in flight together all recycles
+template<class Tag = void>
 struct op_cache
 {
     static void* allocate(std::size_t n)
@@ -59,6 +63,106 @@ private:
     }
 };
 
+// Default associated allocator, backed by the thread-local op_cache
+struct recycling_allocator
+{
+    void* allocate(std::size_t n) const
+    {
+        return op_cache<>::allocate(n);
+    }
+
+    void deallocate(void* p, std::size_t n) const noexcept
+    {
+        op_cache<>::deallocate(p, n);
+    }
+};
+
+} // detail
+
+/** Obtains the allocator associated with a completion handler.
+
+    Operations use this allocator for the memory they need while the
+    handler is outstanding, such as the `io_op` that carries it through
+    the executor. A handler supplies its own allocator through a
+    `get_allocator()` member; otherwise the thread-local recycling
+    allocator is used. Composed operations forward the allocator of
+    the handler they wrap.
+
+    An allocator provides `allocate(n)` and `deallocate(p, n)`, the
+    same shape as a coroutine frame allocator.
+
+    @tparam Handler The completion handler type.
+*/
+template<class Handler>
+struct associated_allocator
+{
+    using type = detail::recycling_allocator;
+
+    static type get(Handler const&) noexcept
+    {
+        return {};
+    }
+};
+
+template<class Handler>
+    requires requires(Handler const& h) { h.get_allocator(); }
+struct associated_allocator<Handler>
+{
+    using type = decltype(std::declval<Handler const&>().get_allocator());
+
+    static type get(Handler const& h) noexcept
+    {
+        return h.get_allocator();
+    }
+};
+
+template<class Handler>
+typename associated_allocator<Handler>::type
+get_associated_allocator(Handler const& h) noexcept
+{
+    return associated_allocator<Handler>::get(h);
+}
+
+namespace detail {
+
+// A single block of memory a composed operation owns for its io_ops
+struct handler_memory
+{
+    static constexpr std::size_t capacity = 256;
+
+    alignas(std::max_align_t) unsigned char storage[capacity];
+    bool in_use = false;
+};
+
+// Allocates from a handler_memory, falling back to Upstream when it
+// is occupied or too small
+template<class Upstream>
+struct handler_allocator
+{
+    handler_memory* mem_;
+    Upstream upstream_;
+
+    void* allocate(std::size_t n)
+    {
+        if(! mem_->in_use && n <= handler_memory::capacity)
+        {
+            mem_->in_use = true;
+            return mem_->storage;
+        }
+        return upstream_.allocate(n);
+    }
+
+    void deallocate(void* p, std::size_t n)
+    {
+        if(p == mem_->storage)
+        {
+            mem_->in_use = false;
+            return;
+        }
+        upstream_.deallocate(p, n);
+    }
+};
+
 // Native callback operations
 template<class Executor, class Handler>
 struct io_op : work
@@ -69,23 +173,27 @@ struct io_op : work
     io_op(Executor ex, Handler h)
         : ex_(ex), handler_(std::move(h)) {}
 
-    static void* operator new(std::size_t n)
-    {
-        return op_cache::allocate(n);
-    }
-
-    static void operator delete(void* p, std::size_t n)
-    {
-        op_cache::deallocate(p, n);
-    }
-
     void operator()() override
     {
         auto h = std::move(handler_);
         auto ex = ex_;
-        delete this;
+        // Memory is released before the upcall so the handler can reuse it
+        auto alloc = get_associated_allocator(h);
+        this->~io_op();
+        alloc.deallocate(this, sizeof(io_op));
         ex.dispatch(std::move(h));
     }
+
+    // The memory came from the handler's allocator. As in operator(),
+    // the handler is moved out first: it may own the memory this op
+    // lives in, or its allocator may refer to it
+    void destroy() noexcept override
+    {
+        auto h = std::move(handler_);
+        auto alloc = get_associated_allocator(h);
+        this->~io_op();
+        alloc.deallocate(this, sizeof(io_op));
+    }
 };
 
 //----------------------------------------------------------
@@ -100,6 +208,11 @@ struct read_op
     read_op(Stream& stream, Handler h)
         : stream_(&stream), handler_(std::move(h)) {}
 
+    auto get_allocator() const noexcept
+    {
+        return get_associated_allocator(handler_);
+    }
+
     void operator()()
     {
         if(count_++ < 5)
@@ -121,18 +234,70 @@ struct request_op
     request_op(Stream& stream, Handler h)
         : stream_(&stream), handler_(std::move(h)) {}
 
+    auto get_allocator() const noexcept
+    {
+        return get_associated_allocator(handler_);
+    }
+
     void operator()();
 };
 
+// Owns a handler_memory for the whole session, so each io_op it
+// issues reuses the same block whatever else is in flight.
+//
+// While a request is pending this op lives inside that block, as the
+// handler of the io_op. So the block is only freed where the op is
+// not in it: io_op moves its handler out before releasing itself,
+// and the op hands the block out with release_memory before freeing.
 template<class Stream, class Handler>
 struct session_op
 {
     Stream* stream_;
     Handler handler_;
+    handler_memory* mem_;
     int count_ = 0;
 
     session_op(Stream& stream, Handler h)
-        : stream_(&stream), handler_(std::move(h)) {}
+        : stream_(&stream), handler_(std::move(h))
+    {
+        auto alloc = get_associated_allocator(handler_);
+        mem_ = ::new(alloc.allocate(sizeof(handler_memory))) handler_memory;
+    }
+
+    session_op(session_op&& other) noexcept
+        : stream_(other.stream_)
+        , handler_(std::move(other.handler_))
+        , mem_(std::exchange(other.mem_, nullptr))
+        , count_(other.count_)
+    {
+    }
+
+    ~session_op()
+    {
+        free_memory(handler_, release_memory());
+    }
+
+    auto get_allocator() const noexcept
+    {
+        using upstream = typename associated_allocator<Handler>::type;
+        return handler_allocator<upstream>{
+            mem_, get_associated_allocator(handler_)};
+    }
+
+    // Gives up the block, leaving the caller to free it
+    handler_memory* release_memory() noexcept
+    {
+        return std::exchange(mem_, nullptr);
+    }
+
+    // Frees a released block with the allocator of the handler that owned it
+    static void free_memory(Handler const& h, handler_memory* mem) noexcept
+    {
+        if(! mem)
+            return;
+        mem->~handler_memory();
+        get_associated_allocator(h).deallocate(mem, sizeof(handler_memory));
+    }
 
     void operator()();
 };
@@ -147,6 +312,11 @@ struct tls_read_op
     tls_read_op(Stream& stream, Handler h)
         : stream_(&stream), handler_(std::move(h)) {}
 
+    auto get_allocator() const noexcept
+    {
+        return get_associated_allocator(handler_);
+    }
+
     void operator()()
     {
         if(count_++ < 1)
@@ -158,6 +328,174 @@ struct tls_read_op
     }
 };
 
+//----------------------------------------------------------
+// Stable-state composition: the op lives at a fixed address for
+// its whole lifetime and only a stable_ref is moved per step
+
+// Frees an op that will not complete, with its handler's allocator
+template<class Op>
+void destroy_stable(Op* op) noexcept
+{
+    auto h = std::move(op->handler_);
+    auto alloc = get_associated_allocator(h);
+    op->~Op();
+    alloc.deallocate(op, sizeof(Op));
+}
+
+// Pointer-sized handler that resumes a stable op. It owns the op
+// until it is invoked, so an io_op destroyed without running
+// releases the op along with its handler.
+template<class Op>
+struct stable_ref
+{
+    Op* op_;
+
+    explicit stable_ref(Op* op) noexcept
+        : op_(op) {}
+
+    stable_ref(stable_ref&& other) noexcept
+        : op_(std::exchange(other.op_, nullptr)) {}
+
+    ~stable_ref()
+    {
+        if(op_)
+            destroy_stable(op_);
+    }
+
+    auto get_allocator() const noexcept
+    {
+        return op_->get_allocator();
+    }
+
+    void operator()()
+    {
+        std::exchange(op_, nullptr)->resume();
+    }
+};
+
+// Allocates Op with its handler's allocator and takes the first step
+template<class Op, class Stream, class Handler>
+void start_stable(Stream& stream, Handler&& handler)
+{
+    auto alloc = get_associated_allocator(handler);
+    auto* op = ::new(alloc.allocate(sizeof(Op))) Op(
+        stream, std::forward<Handler>(handler));
+    op->resume();
+}
+
+// Frees the op before invoking its handler, so the handler can reuse the memory
+template<class Op>
+void complete_stable(Op* op)
+{
+    auto h = std::move(op->handler_);
+    auto alloc = get_associated_allocator(h);
+    op->~Op();
+    alloc.deallocate(op, sizeof(Op));
+    h();
+}
+
+template<class Stream, class Handler>
+struct stable_read_op
+{
+    Stream* stream_;
+    Handler handler_;
+    int count_ = 0;
+
+    stable_read_op(Stream& stream, Handler h)
+        : stream_(&stream), handler_(std::move(h)) {}
+
+    auto get_allocator() const noexcept
+    {
+        return get_associated_allocator(handler_);
+    }
+
+    void resume()
+    {
+        if(count_++ < 5)
+        {
+            stream_->async_read_some(stable_ref<stable_read_op>{this});
+            return;
+        }
+        complete_stable(this);
+    }
+};
+
+template<class Stream, class Handler>
+struct stable_tls_read_op
+{
+    Stream* stream_;
+    Handler handler_;
+    int count_ = 0;
+
+    stable_tls_read_op(Stream& stream, Handler h)
+        : stream_(&stream), handler_(std::move(h)) {}
+
+    auto get_allocator() const noexcept
+    {
+        return get_associated_allocator(handler_);
+    }
+
+    void resume()
+    {
+        if(count_++ < 1)
+        {
+            stream_->async_read_some(stable_ref<stable_tls_read_op>{this});
+            return;
+        }
+        complete_stable(this);
+    }
+};
+
+template<class Stream, class Handler>
+struct stable_request_op
+{
+    Stream* stream_;
+    Handler handler_;
+    int count_ = 0;
+
+    stable_request_op(Stream& stream, Handler h)
+        : stream_(&stream), handler_(std::move(h)) {}
+
+    auto get_allocator() const noexcept
+    {
+        return get_associated_allocator(handler_);
+    }
+
+    void resume()
+    {
+        if(count_++ < 10)
+        {
+            stream_->async_read_some(stable_ref<stable_request_op>{this});
+            return;
+        }
+        complete_stable(this);
+    }
+};
+
+// Embeds the handler_memory its child requests are allocated from,
+// leaving the upstream allocator to recycle the io_ops
+template<class Stream, class Handler>
+struct stable_session_op
+{
+    Stream* stream_;
+    Handler handler_;
+    // Allocated from through get_allocator, which is const like every op's
+    mutable handler_memory mem_;
+    int count_ = 0;
+
+    stable_session_op(Stream& stream, Handler h)
+        : stream_(&stream), handler_(std::move(h)) {}
+
+    auto get_allocator() const noexcept
+    {
+        using upstream = typename associated_allocator<Handler>::type;
+        return handler_allocator<upstream>{
+            &mem_, get_associated_allocator(handler_)};
+    }
+
+    void resume();
+};
+
 } // detail
 } // cb
 
@@ -14,9 +14,13 @@
 #include "bench_co_detail.hpp"
 #include "bench_traits.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <exception>
 #include <memory>
+#include <optional>
 #include <stdexcept>
+#include <type_traits>
 
 #if defined(__clang__) && !defined(__apple_build_version__)
 #define CORO_AWAIT_ELIDABLE [[clang::coro_await_elidable]]
@@ -39,6 +43,14 @@ namespace co {
     @note This is a simulation for benchmarking purposes. Real implementations
     would integrate with OS-level async I/O facilities.
 
+    @par Native descriptors
+    On Linux a socket constructed from a descriptor can also send bytes
+    for real. `async_write` copies from a user buffer, while
+    `async_sendfile` and `async_splice` move file or pipe data to the
+    socket inside the kernel. Each of these awaitables holds its own
+    operation state, so it allocates nothing, and it completes through
+    the caller's executor.
+
     @see async_read_some_t
     @see has_frame_allocator
 */
@@ -72,6 +84,170 @@ struct socket
         return async_read_some_t(*this);
     }
 
+#if defined(__linux__)
+    /** Awaitable that writes a whole buffer to the socket.
+
+        @see async_write
+    */
+    struct async_write_t : detail::fd_op<async_write_t>
+    {
+        async_write_t(int fd, void const* data, std::size_t size) noexcept
+            : fd_op(fd, size), fd_(fd), data_(static_cast<char const*>(data)) {}
+
+        ::ssize_t transfer(std::size_t n) noexcept
+        {
+            return ::send(fd_, data_ + transferred_, n, MSG_NOSIGNAL);
+        }
+
+    private:
+        int fd_;
+        char const* data_;
+    };
+
+    /** Awaitable that sends part of a file with `sendfile`.
+
+        @see async_sendfile
+    */
+    struct async_sendfile_t : detail::fd_op<async_sendfile_t>
+    {
+        async_sendfile_t(int fd, int file, ::off_t offset, std::size_t count) noexcept
+            : fd_op(fd, count), fd_(fd), file_(file), offset_(offset) {}
+
+        ::ssize_t transfer(std::size_t n) noexcept
+        {
+            return ::sendfile(fd_, file_, &offset_, n);
+        }
+
+    private:
+        int fd_;
+        int file_;
+        ::off_t offset_;
+    };
+
+    /** Awaitable that moves bytes from a descriptor through a pipe.
+
+        @see async_splice
+    */
+    struct async_splice_t : detail::fd_op<async_splice_t>
+    {
+        async_splice_t(socket& s, int in, ::loff_t offset, std::size_t count) noexcept
+            : fd_op(s.fd_, count), s_(&s), in_(in), offset_(offset)
+        {
+            error_ = s.pipe_.open();
+            if(error_)
+                remaining_ = 0;
+        }
+
+        ::ssize_t transfer(std::size_t n) noexcept
+        {
+            // Fill the pipe only once it is empty, so that at most
+            // `n` bytes are ever in flight and none are left behind
+            if(fill_ == 0)
+            {
+                ::ssize_t r = ::splice(in_, offset_ < 0 ? nullptr : &offset_,
+                    s_->pipe_.write_, nullptr, std::min(n, s_->pipe_.size_),
+                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if(r <= 0)
+                {
+                    wait_fd_ = in_;
+                    wait_ = wait_type::read;
+                    return r;
+                }
+                fill_ = static_cast<std::size_t>(r);
+            }
+            wait_fd_ = s_->fd_;
+            wait_ = wait_type::write;
+            ::ssize_t r = ::splice(s_->pipe_.read_, nullptr, s_->fd_, nullptr,
+                fill_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK |
+                    (fill_ < n ? SPLICE_F_MORE : 0));
+            if(r > 0)
+                fill_ -= static_cast<std::size_t>(r);
+            return r;
+        }
+
+        // Bytes stranded in the pipe would corrupt the next operation
+        void on_error() noexcept
+        {
+            if(fill_ != 0)
+                s_->pipe_.close();
+        }
+
+    private:
+        socket* s_;
+        int in_;
+        ::loff_t offset_;
+        std::size_t fill_ = 0;
+    };
+
+    /** Constructs a socket which sends on a native descriptor.
+
+        The descriptor is put in non-blocking mode. The caller keeps
+        ownership and must keep it open for the life of the socket.
+        `async_read_some` remains simulated.
+    */
+    explicit socket(int fd)
+        : socket()
+    {
+        fd_ = fd;
+        int flags = ::fcntl(fd, F_GETFL);
+        if(flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+            throw std::system_error(errno, std::generic_category());
+    }
+
+    int native_handle() const noexcept
+    {
+        return fd_;
+    }
+
+    /** Writes a buffer to the socket, copying it into the kernel.
+
+        The operation completes once every byte is sent, retrying
+        partial writes. It resumes the caller with the number of bytes
+        written, and throws `std::system_error` on failure.
+
+        @param data The bytes to send; must stay valid until completion.
+        @param size The number of bytes to send.
+    */
+    async_write_t async_write(void const* data, std::size_t size) noexcept
+    {
+        return { fd_, data, size };
+    }
+
+    /** Sends part of a file without copying it through user space.
+
+        The operation completes once `count` bytes are sent or the file
+        ends, retrying partial sends. It resumes the caller with the
+        number of bytes sent, and throws `std::system_error` on failure.
+
+        @param file A descriptor for a regular file; its position is unchanged.
+        @param offset The offset in the file to start from.
+        @param count The number of bytes to send.
+    */
+    async_sendfile_t async_sendfile(int file, ::off_t offset, std::size_t count) noexcept
+    {
+        return { fd_, file, offset, count };
+    }
+
+    /** Moves bytes from a descriptor to the socket through a pipe.
+
+        The bytes travel from `in` into a pipe owned by the socket and
+        on to the socket as page references, without a user-space copy.
+        Unlike `async_sendfile` the source may be a file, a pipe or
+        another socket. The operation completes once `count` bytes are
+        sent or the input ends. It resumes the caller with the number of
+        bytes sent, and throws `std::system_error` on failure.
+
+        @param in The descriptor to read from.
+        @param offset The offset to read a file at, or -1 to read from
+        the descriptor's current position, as for a pipe or socket.
+        @param count The number of bytes to send.
+    */
+    async_splice_t async_splice(int in, ::loff_t offset, std::size_t count) noexcept
+    {
+        return { *this, in, offset, count };
+    }
+#endif
+
     detail::frame_pool& get_frame_allocator()
     {
         return pool_;
@@ -83,6 +259,9 @@ private:
         coro h_;
         any_executor const* ex_;
     
+        // Owned by the socket
+        void destroy() noexcept override {}
+
         void operator()() override
         {
             // dispatch() returns the handle for symmetric transfer, allowing
@@ -99,6 +278,10 @@ private:
         ex->post(read_op_.get());
     }
 
+#if defined(__linux__)
+    int fd_ = -1;
+    detail::splice_pipe pipe_;
+#endif
     std::unique_ptr<read_state> read_op_;
     detail::frame_pool pool_;
 };
@@ -130,11 +313,12 @@ private:
 */
 struct CORO_AWAIT_ELIDABLE task
 {
-    struct promise_type : detail::frame_pool::promise_allocator
+    struct promise_type : detail::frame_pool::promise_allocator, work
     {
         any_executor const* ex_ = nullptr;
         any_executor const* caller_ex_ = nullptr;
         coro continuation_;
+        bool hopped_ = false;
 
         task get_return_object()
         {
@@ -151,6 +335,12 @@ struct CORO_AWAIT_ELIDABLE task
                 std::coroutine_handle<> await_suspend(coro h) const noexcept
                 {
                     std::coroutine_handle<> next = std::noop_coroutine();
+                    if(p_->hopped_ && p_->continuation_)
+                    {
+                        // Finish on the caller's executor; operator() destroys the frame
+                        p_->caller_ex_->post(p_);
+                        return next;
+                    }
                     if(p_->continuation_)
                         next = p_->caller_ex_->dispatch(p_->continuation_);
                     h.destroy();
@@ -190,6 +380,25 @@ struct CORO_AWAIT_ELIDABLE task
         {
             ex_ = &ex;
         }
+
+        // The task that owns the frame destroys it
+        void destroy() noexcept override {}
+
+        // Posted to hop executors: starts the task on its own executor,
+        // or resumes the caller on its executor once the task is done
+        void operator()() override
+        {
+            auto h = std::coroutine_handle<promise_type>::from_promise(*this);
+            if(! h.done())
+            {
+                h.resume();
+                return;
+            }
+            auto c = continuation_;
+            auto ex = caller_ex_;
+            h.destroy();
+            ex->dispatch(c).resume();
+        }
     };
 
     std::coroutine_handle<promise_type> h_;
@@ -203,28 +412,17 @@ struct CORO_AWAIT_ELIDABLE task
         h_.promise().caller_ex_ = &caller_ex;
         h_.promise().continuation_ = continuation;
 
-        if(has_own_ex_)
+        if(has_own_ex_ && h_.promise().ex_->context() != caller_ex.context())
         {
-            struct starter : work
-            {
-                coro h_;
-                starter(coro h) : h_(h) {}
-                void operator()() override
-                {
-                    h_.resume();
-                    delete this;
-                }
-            };
-            h_.promise().ex_->post(new starter{h_});
-            // Return noop because we posted work; executor will resume us later
+            // The promise is the work item, so a hop does not allocate
+            h_.promise().hopped_ = true;
+            h_.promise().ex_->post(&h_.promise());
             return std::noop_coroutine();
         }
-        else
-        {
-            // Return our handle for symmetric transfer to avoid stack growth
+        if(! has_own_ex_)
             h_.promise().ex_ = &caller_ex;
-            return h_;
-        }
+        // Return our handle for symmetric transfer to avoid stack growth
+        return h_;
     }
 
     void start(any_executor const& ex)
@@ -270,13 +468,15 @@ inline auto get_executor_ptr()
         
         bool await_ready() const noexcept { return false; }
         
-        template<class Promise>
-        void await_suspend(std::coroutine_handle<Promise> h) noexcept
+        // Local classes cannot declare member templates, so the
+        // promise type is selected by overload instead
+        void await_suspend(std::coroutine_handle<task::promise_type> h) noexcept
+        {
+            p_ = &h.promise();
+        }
+
+        void await_suspend(coro) noexcept
         {
-            if constexpr (std::same_as<Promise, task::promise_type>)
-            {
-                p_ = &h.promise();
-            }
         }
         
         any_executor const* await_resume() const noexcept
@@ -315,13 +515,15 @@ inline auto get_executor()
         
         bool await_ready() const noexcept { return false; }
         
-        template<class Promise>
-        void await_suspend(std::coroutine_handle<Promise> h) noexcept
+        // Local classes cannot declare member templates, so the
+        // promise type is selected by overload instead
+        void await_suspend(std::coroutine_handle<task::promise_type> h) noexcept
+        {
+            p_ = &h.promise();
+        }
+
+        void await_suspend(coro) noexcept
         {
-            if constexpr (std::same_as<Promise, task::promise_type>)
-            {
-                p_ = &h.promise();
-            }
         }
         
         any_executor const& await_resume() const
@@ -334,12 +536,148 @@ inline auto get_executor()
     return awaiter{};
 }
 
+/** An affine awaitable running a small state machine without a frame.
+
+    A layer which only forwards to, or sequences, a few awaits of the
+    layer below does not need a coroutine of its own. `Impl` holds the
+    layer's state and describes its steps:
+
+    @li `bool done()` returns `true` once no steps remain
+    @li `step()` advances the state and returns the awaitable for the
+        next step, which must be the same type every time
+    @li `result()`, if present, supplies the value of the `co_await`
+
+    The awaitable lives in the caller's frame, so the layer allocates
+    nothing. It stands in as the executor of each step: when a step
+    completes by dispatching the caller through it, the next step is
+    started in place, and after the last one the caller is dispatched
+    through its own executor. Everything else dispatched or posted
+    through it, such as the inner work of a step that is a `task`, is
+    forwarded to the caller's executor unchanged.
+
+    @par Example
+    @code
+    struct read_twice
+    {
+        socket* s_;
+        int n_ = 0;
+
+        bool done() const noexcept { return n_ == 2; }
+        auto step() { ++n_; return s_->async_read_some(); }
+    };
+
+    co_await composed_awaitable<read_twice>{{&sock}};
+    @endcode
+
+    @tparam Impl The state machine type.
+*/
+template<class Impl>
+class composed_awaitable : any_executor
+{
+    using step_type = decltype(std::declval<Impl&>().step());
+
+    Impl impl_;
+    std::optional<step_type> step_;
+    coro h_;
+    any_executor const* ex_ = nullptr;
+
+    // Runs steps until one suspends or none remain, returning the
+    // handle to transfer to, or a null handle when the caller is next
+    coro advance()
+    {
+        while(! impl_.done())
+        {
+            step_.emplace(impl_.step());
+            if(! step_->await_ready())
+            {
+                using result = decltype(step_->await_suspend(h_, *this));
+                if constexpr(std::is_void_v<result>)
+                {
+                    step_->await_suspend(h_, *this);
+                    return std::noop_coroutine();
+                }
+                else if constexpr(std::is_same_v<result, bool>)
+                {
+                    if(step_->await_suspend(h_, *this))
+                        return std::noop_coroutine();
+                }
+                else
+                {
+                    return step_->await_suspend(h_, *this);
+                }
+            }
+            step_->await_resume();
+            step_.reset();
+        }
+        return nullptr;
+    }
+
+    coro dispatch(coro h) const override
+    {
+        if(h != h_)
+            return ex_->dispatch(h);
+        // A step completed. Only the owner hands out this executor,
+        // so the object is not actually const
+        auto& self = const_cast<composed_awaitable&>(*this);
+        self.step_->await_resume();
+        self.step_.reset();
+        if(coro next = self.advance())
+            return next;
+        return ex_->dispatch(h_);
+    }
+
+    void post(work* w) const override
+    {
+        ex_->post(w);
+    }
+
+    void const* context() const noexcept override
+    {
+        return ex_->context();
+    }
+
+public:
+    explicit composed_awaitable(Impl impl)
+        : impl_(std::move(impl))
+    {
+    }
+
+    composed_awaitable(composed_awaitable&& other)
+        : impl_(std::move(other.impl_))
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return impl_.done();
+    }
+
+    coro await_suspend(coro h, any_executor const& ex)
+    {
+        h_ = h;
+        ex_ = &ex;
+        if(coro next = advance())
+            return next;
+        // Every step completed inline
+        return h;
+    }
+
+    decltype(auto) await_resume()
+    {
+        if constexpr(requires { impl_.result(); })
+            return impl_.result();
+    }
+};
+
 /** A TLS stream adapter that wraps another stream.
 
     This class wraps a stream and provides an async_read_some
     operation that invokes the wrapped stream's async_read_some
     once, simulating TLS record layer behavior.
 
+    The read is a `composed_awaitable`, so the layer adds no
+    coroutine frame to the caller's.
+
     @tparam Stream The stream type to wrap.
 */
 template<class Stream>
@@ -353,9 +691,24 @@ struct tls_stream
 
     auto get_executor() const { return stream_.get_executor(); }
 
-    task async_read_some()
+    // One record: a single read of the wrapped stream
+    struct read_some_impl
     {
-        co_await stream_.async_read_some();
+        Stream* stream_;
+        bool read_ = false;
+
+        bool done() const noexcept { return read_; }
+
+        auto step()
+        {
+            read_ = true;
+            return stream_->async_read_some();
+        }
+    };
+
+    composed_awaitable<read_some_impl> async_read_some()
+    {
+        return composed_awaitable<read_some_impl>(read_some_impl{&stream_});
     }
 
     template<class Stream2 = Stream>
@@ -371,7 +724,12 @@ struct tls_stream
     This function sets the executor for a task, causing it to run on the
     specified executor rather than inheriting the caller's executor. When
     awaited, the task will be posted to its bound executor instead of
-    executing inline via symmetric transfer.
+    executing inline via symmetric transfer, and on completion the caller
+    is posted back to its own executor. The promise itself is the posted
+    work item, so a hop does not allocate. If the bound executor has the
+    same context as the caller's, the task starts inline as usual. The
+    lanes of an `io_context` are distinct contexts, so binding a task
+    to another lane of the caller's context still posts it there.
 
     @param ex The executor on which the task should run.
     @param t The task to bind to the executor.
@@ -383,12 +741,148 @@ struct tls_stream
     co_await run_on(strand, some_task());
     @endcode
 */
-task run_on(any_executor const& ex, task t)
+inline task run_on(any_executor const& ex, task t)
 {
     t.set_executor(ex);
     return t;
 }
 
+/** A scope which joins a dynamic number of child tasks.
+
+    Children are started with `co_await group.spawn(t)`, which runs
+    the child on the caller's executor until its first suspension and
+    then resumes the caller. `co_await group.join()` suspends the
+    caller until every child spawned so far has finished. A child
+    bound with `run_on` is posted to its own executor instead.
+
+    The group acts as the caller executor of its children: a child's
+    final suspend dispatches to the group, which decrements an atomic
+    count and resumes the joining task when it reaches zero. The only
+    allocation per child is the child's own frame.
+
+    The count holds one extra reference for the joiner, so a child
+    finishing before `join()` is awaited never resumes anything. The
+    group may be joined again after more spawns.
+
+    @par Example
+    @code
+    task gather(std::vector<backend>& backends)
+    {
+        task_group group;
+        for(auto& b : backends)
+            co_await group.spawn(query(b));
+        co_await group.join();
+    }
+    @endcode
+
+    @note The group must be joined before it is destroyed, and the
+    caller's executor must outlive the children.
+*/
+class task_group : any_executor
+{
+    mutable std::atomic<std::size_t> count_{1};
+    any_executor const* ex_ = nullptr;
+    any_executor const* waiter_ex_ = nullptr;
+    coro waiter_;
+
+    // Called by a child's final suspend in place of its caller executor
+    coro dispatch(coro) const override
+    {
+        if(count_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            return waiter_ex_->dispatch(waiter_);
+        return std::noop_coroutine();
+    }
+
+    void post(work* w) const override
+    {
+        ex_->post(w);
+    }
+
+    void const* context() const noexcept override
+    {
+        return ex_->context();
+    }
+
+public:
+    task_group() = default;
+    task_group(task_group const&) = delete;
+    task_group& operator=(task_group const&) = delete;
+
+    struct spawn_awaiter
+    {
+        task_group& g_;
+        task t_;
+
+        bool await_ready() const noexcept { return false; }
+        void await_resume() const noexcept {}
+
+        bool await_suspend(coro, any_executor const& ex)
+        {
+            // Children on other executors may be reading it already
+            if(! g_.ex_)
+                g_.ex_ = &ex;
+            g_.count_.fetch_add(1, std::memory_order_relaxed);
+            if(t_.has_own_ex_)
+            {
+                t_.await_suspend(std::noop_coroutine(), g_).resume();
+                return false;
+            }
+            auto& p = t_.h_.promise();
+            p.ex_ = &ex;
+            p.caller_ex_ = &g_;
+            // Any non-null handle; the group ignores it
+            p.continuation_ = std::noop_coroutine();
+            t_.h_.resume();
+            return false;
+        }
+    };
+
+    struct join_awaiter
+    {
+        task_group& g_;
+
+        bool await_ready() const noexcept
+        {
+            return g_.count_.load(std::memory_order_acquire) == 1;
+        }
+
+        std::coroutine_handle<> await_suspend(coro h, any_executor const& ex)
+        {
+            g_.waiter_ = h;
+            g_.waiter_ex_ = &ex;
+            // Drop the joiner's reference; if it was the last, nothing is running
+            if(g_.count_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                return h;
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+            g_.count_.store(1, std::memory_order_relaxed);
+        }
+    };
+
+    /** Starts a child task on the caller's executor.
+    */
+    spawn_awaiter spawn(task t)
+    {
+        return { *this, t };
+    }
+
+    /** Waits for every spawned child to finish.
+    */
+    join_awaiter join()
+    {
+        return { *this };
+    }
+
+    // Returns the number of children still running
+    std::size_t size() const noexcept
+    {
+        return count_.load(std::memory_order_relaxed) - 1;
+    }
+};
+
 template<class Executor>
 detail::root_task<Executor> detail::wrapper(task t)
 {
@@ -423,11 +917,54 @@ void async_run(Executor ex, task t)
 {
     auto root = detail::wrapper<Executor>(std::move(t));
     root.h_.promise().ex_ = std::move(ex);
-    root.h_.promise().starter_.h_ = root.h_;
-    root.h_.promise().ex_.post(&root.h_.promise().starter_);
+    root.h_.promise().ex_.post(&root.h_.promise());
     root.release();
 }
 
+/** Starts a batch of tasks for execution on an executor.
+
+    This function creates `n` root tasks, calling `make_task(i)` for
+    each index, and links them into a local queue which is handed to
+    the executor in a single operation. For an `io_context` this is
+    one splice of the context's queue however large the batch is.
+    Executors without a batch `post(work_queue&)` receive the tasks
+    one at a time.
+
+    As with `async_run`, every task is fire and forget.
+
+    @param ex The executor on which to run the tasks.
+    @param n The number of tasks to start.
+    @param make_task A function returning the `task` for an index.
+
+    @par Example
+    @code
+    async_run_batch(ioc.get_executor(), conns.size(),
+        [&](std::size_t i) { return async_session(conns[i]); });
+    ioc.run();
+    @endcode
+*/
+template<class Executor, class MakeTask>
+void async_run_batch(Executor ex, std::size_t n, MakeTask make_task)
+{
+    work_queue batch;
+    for(std::size_t i = 0; i < n; ++i)
+    {
+        auto root = detail::wrapper<Executor>(make_task(i));
+        root.h_.promise().ex_ = ex;
+        batch.push(&root.h_.promise());
+        root.release();
+    }
+    if constexpr(requires { ex.post(batch); })
+    {
+        ex.post(batch);
+    }
+    else
+    {
+        while(auto* w = batch.pop())
+            ex.post(w);
+    }
+}
+
 /** Performs a composed read operation on a stream.
 
     This coroutine performs 5 sequential read_some operations on the
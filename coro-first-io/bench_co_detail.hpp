@@ -11,12 +11,37 @@
 #define BENCH_CO_DETAIL_HPP
 
 #include "bench.hpp"
+#include "bench_numa.hpp"
 #include "bench_traits.hpp"
 
+#include <atomic>
 #include <coroutine>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <exception>
 #include <mutex>
+#include <new>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define FRAME_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define FRAME_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
 
 namespace co {
 
@@ -25,66 +50,227 @@ struct task;
 
 namespace detail {
 
-// Frame pool: thread-local with global overflow
-// Tracks block sizes to avoid returning undersized blocks
-class frame_pool
+/** Records the sizes of coroutine frames as they are allocated.
+
+    When enabled, every frame allocated through
+    `frame_pool::promise_allocator` is counted in a histogram keyed
+    by call site, size, and the tag of the innermost `scope` active
+    on the allocating thread. The call site is the return address of
+    the promise's `operator new`, which is inside the coroutine's
+    ramp function (or its caller, if the allocation was inlined).
+
+    Recording is off by default; the only cost on the allocation
+    path is then a relaxed load and a predictable branch.
+
+    @par Example
+    @code
+    frame_recorder::enable(true);
+    {
+        frame_recorder::scope s("session");
+        async_run(ioc.get_executor(), async_session(sock));
+        ioc.run();
+    }
+    for(auto const& e : frame_recorder::entries())
+        std::cout << e.tag << " " << e.size << " x" << e.count << "\n";
+    @endcode
+*/
+class frame_recorder
 {
-    struct block
+public:
+    struct entry
     {
-        block* next;
+        char const* tag;
+        void const* site;
         std::size_t size;
+        std::size_t count;
     };
 
-    struct global_pool
+    /** Names the frames allocated on this thread while it is alive.
+    */
+    class scope
     {
-        std::mutex mtx;
-        block* head = nullptr;
+        char const* prev_;
 
-        ~global_pool()
+    public:
+        explicit scope(char const* tag) noexcept
+            : prev_(current_tag())
         {
-            while(head)
-            {
-                auto p = head;
-                head = head->next;
-                ::operator delete(p);
-            }
+            current_tag() = tag;
         }
 
-        void push(block* b)
+        ~scope()
         {
-            std::lock_guard<std::mutex> lock(mtx);
-            b->next = head;
-            head = b;
+            current_tag() = prev_;
         }
 
-        block* pop(std::size_t n)
+        scope(scope const&) = delete;
+        scope& operator=(scope const&) = delete;
+    };
+
+    static void enable(bool on) noexcept
+    {
+        enabled_.store(on, std::memory_order_relaxed);
+    }
+
+    static bool enabled() noexcept
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    static void record(void const* site, std::size_t size)
+    {
+        auto& s = state();
+        char const* tag = current_tag();
+        std::lock_guard<std::mutex> lock(s.mtx);
+        for(auto& e : s.entries)
         {
-            std::lock_guard<std::mutex> lock(mtx);
-            block** pp = &head;
-            while(*pp)
+            if(e.site == site && e.size == size && e.tag == tag)
             {
-                // block->size stores total allocated size (including header), so we must
-                // check against n + sizeof(block) to ensure the block can satisfy the request
-                if((*pp)->size >= n + sizeof(block))
-                {
-                    block* p = *pp;
-                    *pp = p->next;
-                    return p;
-                }
-                pp = &(*pp)->next;
+                ++e.count;
+                return;
             }
-            return nullptr;
         }
+        s.entries.push_back({tag, site, size, 1});
+    }
+
+    // Returns a copy of the histogram in first-seen order
+    static std::vector<entry> entries()
+    {
+        auto& s = state();
+        std::lock_guard<std::mutex> lock(s.mtx);
+        return s.entries;
+    }
+
+    static void clear()
+    {
+        auto& s = state();
+        std::lock_guard<std::mutex> lock(s.mtx);
+        s.entries.clear();
+    }
+
+private:
+    struct shared_state
+    {
+        std::mutex mtx;
+        std::vector<entry> entries;
     };
 
-    struct local_pool
+    static inline std::atomic<bool> enabled_{false};
+
+    static shared_state& state()
+    {
+        static shared_state s;
+        return s;
+    }
+
+    static char const*& current_tag() noexcept
+    {
+        static thread_local char const* tag = "";
+        return tag;
+    }
+};
+
+/** Maps 2 MiB regions for carving coroutine frames.
+
+    Regions are aligned to their size and advised with `MADV_HUGEPAGE`
+    so the kernel can back each one with a single transparent huge
+    page, which keeps the frames of many live coroutines within a few
+    dTLB entries. When the advice is refused the region still works
+    with ordinary pages; when mapping is unavailable `map` returns
+    `nullptr` and the caller falls back to `operator new`.
+
+    Regions are never unmapped; the blocks carved from them are
+    recycled through the frame pools for the life of the process.
+*/
+struct huge_region
+{
+    static constexpr std::size_t size = std::size_t(2) * 1024 * 1024;
+
+    static void* map() noexcept
+    {
+#if defined(__linux__)
+        // Over-map so that an aligned region can be cut out of the middle
+        void* raw = ::mmap(nullptr, 2 * size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(raw == MAP_FAILED)
+            return nullptr;
+        auto addr = reinterpret_cast<std::uintptr_t>(raw);
+        auto aligned = (addr + size - 1) & ~(size - 1);
+        if(aligned > addr)
+            ::munmap(raw, aligned - addr);
+        if(aligned + size < addr + 2 * size)
+            ::munmap(reinterpret_cast<void*>(aligned + size),
+                addr + 2 * size - (aligned + size));
+        void* p = reinterpret_cast<void*>(aligned);
+#if defined(MADV_HUGEPAGE)
+        if(::madvise(p, size, MADV_HUGEPAGE) == 0)
+            huge_count().fetch_add(1, std::memory_order_relaxed);
+#endif
+        count().fetch_add(1, std::memory_order_relaxed);
+        return p;
+#else
+        return nullptr;
+#endif
+    }
+
+    // Number of regions mapped so far
+    static std::atomic<std::size_t>& count() noexcept
+    {
+        static std::atomic<std::size_t> n{0};
+        return n;
+    }
+
+    // Number of regions the kernel accepted MADV_HUGEPAGE for
+    static std::atomic<std::size_t>& huge_count() noexcept
+    {
+        static std::atomic<std::size_t> n{0};
+        return n;
+    }
+};
+
+// Frame pool: thread-local with per-NUMA-node global overflow
+// Tracks block sizes to avoid returning undersized blocks, and the
+// node of the thread that allocated each block so that a frame freed
+// on another node goes back to its home node instead of being reused
+// across the interconnect
+class frame_pool
+{
+    struct block
+    {
+        block* next;
+        std::uint32_t size;
+        std::uint16_t node;
+        std::uint16_t from_slab;
+    };
+
+    // Blocks carved from a huge_region are rounded to this granularity
+    static constexpr std::size_t slab_align = alignof(std::max_align_t);
+
+    // Returns a block to the heap; blocks carved from a huge_region
+    // cannot be returned individually and are kept cached instead
+    static bool release(block* b) noexcept
+    {
+        if(b->from_slab)
+            return false;
+        ::operator delete(b);
+        return true;
+    }
+
+    // Singly linked list of cached blocks with usage counters
+    struct block_list
     {
         block* head = nullptr;
+        std::size_t blocks = 0;
+        std::size_t bytes = 0;
+        std::size_t hits = 0;
+        std::size_t misses = 0;
 
         void push(block* b)
         {
             b->next = head;
             head = b;
+            ++blocks;
+            bytes += b->size;
         }
 
         block* pop(std::size_t n)
@@ -98,34 +284,350 @@ class frame_pool
                 {
                     block* p = *pp;
                     *pp = p->next;
+                    --blocks;
+                    bytes -= p->size;
+                    ++hits;
                     return p;
                 }
                 pp = &(*pp)->next;
             }
+            ++misses;
             return nullptr;
         }
+
+        // Releases blocks until at most keep bytes remain, returning the bytes released
+        std::size_t trim(std::size_t keep)
+        {
+            std::size_t released = 0;
+            block** pp = &head;
+            while(*pp && bytes > keep)
+            {
+                block* p = *pp;
+                std::size_t size = p->size;
+                *pp = p->next;
+                if(release(p))
+                {
+                    --blocks;
+                    bytes -= size;
+                    released += size;
+                }
+                else
+                {
+                    // Relink the slab block and move past it
+                    *pp = p;
+                    pp = &p->next;
+                }
+            }
+            return released;
+        }
     };
 
+    struct global_pool
+    {
+        std::mutex mtx;
+        block_list list;
+
+        ~global_pool()
+        {
+            while(list.head)
+            {
+                auto p = list.head;
+                list.head = list.head->next;
+                release(p);
+            }
+        }
+
+        // Caches b, or releases it if that would exceed cap bytes
+        void push(block* b, std::size_t cap)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if(list.bytes + b->size > cap && release(b))
+                return;
+            list.push(b);
+        }
+
+        block* pop(std::size_t n)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            return list.pop(n);
+        }
+    };
+
+    struct local_pool
+    {
+        block_list list;
+
+        // Memory node the cached blocks belong to; no block matches
+        // the initial value, so the first free synchronizes it
+        std::uint32_t node = std::uint32_t(-1);
+
+        // Unused tail of the thread's current huge_region
+        char* slab_pos = nullptr;
+        char* slab_end = nullptr;
+    };
+
+    // Node-local overflow pools; nodes beyond the table share slots
+    static constexpr std::uint32_t max_nodes = 64;
+
     static local_pool& local()
     {
         static thread_local local_pool local;
         return local;
     }
 
+    // Returns the local pool after moving its blocks to their home
+    // node if the thread's memory node has changed. This is only called
+    // when the fast path misses, so a thread that changes node starts
+    // using the new node's memory at its next refill.
+    static local_pool& synced_local()
+    {
+        auto& lp = local();
+        auto node = static_cast<std::uint32_t>(numa::thread_node());
+        if(lp.node != node)
+        {
+            auto cap = global_cap_.load(std::memory_order_relaxed);
+            while(auto* b = lp.list.head)
+            {
+                lp.list.head = b->next;
+                global(b->node).push(b, cap);
+            }
+            lp.list.blocks = 0;
+            lp.list.bytes = 0;
+            lp.node = node;
+        }
+        return lp;
+    }
+
+    // Caches a block that could not go straight to the local pool
+    static void deallocate_slow(block* b)
+    {
+        auto& lp = synced_local();
+        if(b->node == lp.node &&
+            lp.list.bytes + b->size <= local_cap_.load(std::memory_order_relaxed))
+        {
+            lp.list.push(b);
+            return;
+        }
+        global(b->node).push(b, global_cap_.load(std::memory_order_relaxed));
+    }
+
+    // Obtains a fresh block of total bytes, from a huge_region when enabled
+    static block* refill(std::size_t total)
+    {
+        if(huge_pages_.load(std::memory_order_relaxed) &&
+            total <= huge_region::size)
+        {
+            std::size_t rounded = (total + slab_align - 1) & ~(slab_align - 1);
+            auto& lp = local();
+            if(static_cast<std::size_t>(lp.slab_end - lp.slab_pos) < rounded)
+            {
+                // The tail of the previous region is abandoned
+                auto* r = static_cast<char*>(huge_region::map());
+                if(r)
+                {
+                    lp.slab_pos = r;
+                    lp.slab_end = r + huge_region::size;
+                }
+            }
+            if(static_cast<std::size_t>(lp.slab_end - lp.slab_pos) >= rounded)
+            {
+                auto* b = static_cast<block*>(static_cast<void*>(lp.slab_pos));
+                lp.slab_pos += rounded;
+                b->size = static_cast<std::uint32_t>(rounded);
+                b->from_slab = 1;
+                return b;
+            }
+        }
+        auto* b = static_cast<block*>(::operator new(total));
+        b->size = static_cast<std::uint32_t>(total);
+        b->from_slab = 0;
+        return b;
+    }
+
+    static inline std::atomic<bool> huge_pages_{false};
+    static inline std::atomic<std::size_t> local_cap_{std::size_t(-1)};
+    static inline std::atomic<std::size_t> global_cap_{std::size_t(-1)};
+
 public:
+    /** Usage counters of a frame pool.
+
+        `hits` counts allocations satisfied from the pool's cache and
+        `misses` counts allocations the pool could not satisfy.
+    */
+    struct stats
+    {
+        std::size_t blocks = 0;
+        std::size_t bytes = 0;
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+    };
+
+    /** Caps on the bytes a frame pool keeps cached.
+
+        `local_bytes` applies to each thread's pool and `global_bytes`
+        to each NUMA node's overflow pool. A block freed into a full
+        thread pool overflows to its node's pool, and a block freed into
+        a full node pool is returned to the heap. Both default to no limit.
+    */
+    struct limits
+    {
+        std::size_t local_bytes = std::size_t(-1);
+        std::size_t global_bytes = std::size_t(-1);
+    };
+
+    static void set_limits(limits const& l) noexcept
+    {
+        local_cap_.store(l.local_bytes, std::memory_order_relaxed);
+        global_cap_.store(l.global_bytes, std::memory_order_relaxed);
+    }
+
+    static limits get_limits() noexcept
+    {
+        return {
+            local_cap_.load(std::memory_order_relaxed),
+            global_cap_.load(std::memory_order_relaxed) };
+    }
+
+    // Returns the counters of the calling thread's pool
+    static stats local_stats() noexcept
+    {
+        auto const& l = local().list;
+        return { l.blocks, l.bytes, l.hits, l.misses };
+    }
+
+    // Returns the counters of all node overflow pools combined
+    static stats global_stats()
+    {
+        stats st;
+        for(std::uint32_t i = 0; i < max_nodes; ++i)
+        {
+            auto& g = global(i);
+            std::lock_guard<std::mutex> lock(g.mtx);
+            st.blocks += g.list.blocks;
+            st.bytes += g.list.bytes;
+            st.hits += g.list.hits;
+            st.misses += g.list.misses;
+        }
+        return st;
+    }
+
+    /** Returns cached blocks to the heap.
+
+        Releases blocks from the calling thread's pool until at most
+        `local_keep` bytes remain, then from each node's overflow pool
+        until at most `global_keep` bytes remain. Blocks carved from a
+        huge_region stay cached.
+
+        @return The number of bytes released.
+    */
+    static std::size_t trim(std::size_t local_keep = 0, std::size_t global_keep = 0)
+    {
+        std::size_t released = local().list.trim(local_keep);
+        for(std::uint32_t i = 0; i < max_nodes; ++i)
+        {
+            auto& g = global(i);
+            std::lock_guard<std::mutex> lock(g.mtx);
+            released += g.list.trim(global_keep);
+        }
+        return released;
+    }
+
+    /** Trims the pools each time an io_context runs out of work.
+
+        @param ioc The context whose idle transitions trigger a trim.
+        @param keep The bytes to keep cached, owned by the caller; it is
+        read at each trim and must outlive the hook.
+    */
+    static void trim_on_idle(io_context& ioc, limits* keep)
+    {
+        ioc.on_idle([](void* arg)
+        {
+            auto const& k = *static_cast<limits*>(arg);
+            trim(k.local_bytes, k.global_bytes);
+        }, keep);
+    }
+
+    /** Caches blocks for coroutine frames on the calling thread.
+
+        Allocates `count` blocks, each able to hold a frame of `size`
+        bytes as reported by `frame_recorder`, writes to them so their
+        pages are faulted in, and adds them to the calling thread's
+        pool. Calling this on each worker before traffic arrives keeps
+        `operator new` and page faults out of the first requests. A
+        block serves any frame up to its size. Reserved blocks are not
+        subject to the local cap.
+
+        Frames take the newest cached block that fits, so when reserving
+        several sizes reserve the largest first. Otherwise a small frame
+        can take a block reserved for a larger one, which then misses.
+
+        @return The number of bytes reserved.
+    */
+    static std::size_t reserve(std::size_t size, std::size_t count)
+    {
+        auto& lp = synced_local();
+        std::size_t total = size + sizeof(promise_allocator::header) + sizeof(block);
+        std::size_t bytes = 0;
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            auto* b = refill(total);
+            std::memset(b + 1, 0, b->size - sizeof(block));
+            b->node = static_cast<std::uint16_t>(lp.node);
+            lp.list.push(b);
+            bytes += b->size;
+        }
+        return bytes;
+    }
+
+    /** Reserves blocks on the thread that runs an io_context.
+
+        Posts a work item which calls `reserve(size, count)` when the
+        context runs, so call it before posting the context's first task.
+    */
+    static void reserve(io_context& ioc, std::size_t size, std::size_t count)
+    {
+        struct op : work
+        {
+            std::size_t size;
+            std::size_t count;
+
+            op(std::size_t s, std::size_t n) : size(s), count(n) {}
+
+            void operator()() override
+            {
+                frame_pool::reserve(size, count);
+                delete this;
+            }
+        };
+        ioc.get_executor().post(new op(size, count));
+    }
+
+    /** Enables carving new blocks out of 2 MiB huge-page regions.
+
+        Without this, each block the pools cannot satisfy is a separate
+        `operator new`, which scatters frames across the heap. With it,
+        a thread's refills are packed into a region it maps itself, so
+        they are also local to the thread's NUMA node.
+
+        @see huge_region
+    */
+    static void use_huge_pages(bool on) noexcept
+    {
+        huge_pages_.store(on, std::memory_order_relaxed);
+    }
+
     void* allocate(std::size_t n)
     {
-        std::size_t total = n + sizeof(block);
-        
-        if(auto* b = local().pop(n))
+        if(auto* b = local().list.pop(n))
             return static_cast<char*>(static_cast<void*>(b)) + sizeof(block);
 
-        if(auto* b = global().pop(n))
+        auto node = synced_local().node;
+        if(auto* b = global(node).pop(n))
             return static_cast<char*>(static_cast<void*>(b)) + sizeof(block);
 
-        auto* b = static_cast<block*>(::operator new(total));
+        auto* b = refill(n + sizeof(block));
         b->next = nullptr;
-        b->size = total;
+        b->node = static_cast<std::uint16_t>(node);
         return static_cast<char*>(static_cast<void*>(b)) + sizeof(block);
     }
 
@@ -136,13 +638,20 @@ public:
             static_cast<char*>(p) - sizeof(block)));
         // block->size already contains the true allocated size, so we ignore parameter n
         b->next = nullptr;
-        local().push(b);
+        auto& lp = local();
+        if(b->node == lp.node &&
+            lp.list.bytes + b->size <= local_cap_.load(std::memory_order_relaxed))
+        {
+            lp.list.push(b);
+            return;
+        }
+        deallocate_slow(b);
     }
 
-    static global_pool& global()
+    static global_pool& global(std::uint32_t node)
     {
-        static global_pool pool;
-        return pool;
+        static global_pool pools[max_nodes];
+        return pools[node % max_nodes];
     }
 
     // Shared pool instance for all coroutine frames
@@ -178,12 +687,16 @@ public:
 
         static void* operator new(std::size_t size)
         {
+            if(frame_recorder::enabled())
+                frame_recorder::record(FRAME_RETURN_ADDRESS(), size);
             return allocate_with(size, frame_pool::shared());
         }
 
         template<has_frame_allocator Arg0, class... ArgN>
         static void* operator new(std::size_t size, Arg0& arg0, ArgN&...)
         {
+            if(frame_recorder::enabled())
+                frame_recorder::record(FRAME_RETURN_ADDRESS(), size);
             return allocate_with(size, arg0.get_frame_allocator());
         }
 
@@ -191,6 +704,8 @@ public:
         static void* operator new(std::size_t size, Arg0&, Arg1& arg1, ArgN&...)
             requires (!has_frame_allocator<Arg0>)
         {
+            if(frame_recorder::enabled())
+                frame_recorder::record(FRAME_RETURN_ADDRESS(), size);
             return allocate_with(size, arg1.get_frame_allocator());
         }
 
@@ -207,21 +722,22 @@ public:
 template<class Executor>
 struct root_task
 {
-    struct starter : work
+    // The promise is its own starter: posting it resumes the frame,
+    // so spawning needs no separate work item or stored handle
+    struct promise_type : frame_pool::promise_allocator, work
     {
-        coro h_;
+        Executor ex_;
 
-        void operator()() override
+        // Nothing else owns a spawned frame that has not finished
+        void destroy() noexcept override
         {
-            h_.resume();
-            // Not deleted here because starter is embedded in promise_type's frame
+            std::coroutine_handle<promise_type>::from_promise(*this).destroy();
         }
-    };
 
-    struct promise_type : frame_pool::promise_allocator
-    {
-        Executor ex_;
-        starter starter_;
+        void operator()() override
+        {
+            std::coroutine_handle<promise_type>::from_promise(*this).resume();
+        }
 
         root_task get_return_object()
         {
@@ -282,6 +798,149 @@ struct root_task
 template<class Executor>
 root_task<Executor> wrapper(task t);
 
+#if defined(__linux__)
+
+/** Operation state for moving bytes to a non-blocking descriptor.
+
+    The state is a work item embedded in the awaitable, so an
+    operation allocates nothing. It is posted to the caller's executor
+    to start, then calls `Derived::transfer(n)` until `n` bytes have
+    moved, the input ends or an error occurs, and finally resumes the
+    coroutine through the executor. Partial transfers are retried
+    inside the operation. When a descriptor would block, the item waits
+    for it through `any_executor::post_when_ready`, or is posted again
+    if the executor has no reactor.
+*/
+template<class Derived>
+struct fd_op : work
+{
+    coro h_;
+    any_executor const* ex_ = nullptr;
+    std::size_t remaining_;
+    std::size_t transferred_ = 0;
+    int error_ = 0;
+    // The descriptor to wait on when transfer() would block
+    int wait_fd_;
+    wait_type wait_ = wait_type::write;
+
+    fd_op(int fd, std::size_t n) noexcept
+        : remaining_(n), wait_fd_(fd) {}
+
+    bool await_ready() const noexcept
+    {
+        return remaining_ == 0;
+    }
+
+    std::coroutine_handle<> await_suspend(coro h, any_executor const& ex)
+    {
+        ++g_io_count;
+        h_ = h;
+        ex_ = &ex;
+        ex.post(this);
+        return std::noop_coroutine();
+    }
+
+    // Returns the number of bytes transferred
+    std::size_t await_resume() const
+    {
+        if(error_)
+            throw std::system_error(error_, std::generic_category());
+        return transferred_;
+    }
+
+    // Embedded in the awaitable, in the awaiting frame
+    void destroy() noexcept override {}
+
+    void operator()() override
+    {
+        while(remaining_ > 0)
+        {
+            ::ssize_t n = static_cast<Derived*>(this)->transfer(remaining_);
+            if(n > 0)
+            {
+                transferred_ += static_cast<std::size_t>(n);
+                remaining_ -= static_cast<std::size_t>(n);
+                continue;
+            }
+            if(n == 0)
+                break;
+            if(errno == EINTR)
+                continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                if(! ex_->post_when_ready(this, wait_fd_, wait_))
+                    ex_->post(this);
+                return;
+            }
+            error_ = errno;
+            static_cast<Derived*>(this)->on_error();
+            break;
+        }
+        ex_->dispatch(h_)();
+    }
+
+    void on_error() noexcept {}
+};
+
+// A pipe used to splice between two descriptors without a user buffer,
+// opened on first use
+struct splice_pipe
+{
+    int read_ = -1;
+    int write_ = -1;
+    std::size_t size_ = 0;
+
+    splice_pipe() = default;
+
+    splice_pipe(splice_pipe&& other) noexcept
+        : read_(std::exchange(other.read_, -1))
+        , write_(std::exchange(other.write_, -1))
+        , size_(other.size_)
+    {
+    }
+
+    splice_pipe& operator=(splice_pipe&& other) noexcept
+    {
+        std::swap(read_, other.read_);
+        std::swap(write_, other.write_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    ~splice_pipe()
+    {
+        close();
+    }
+
+    // Returns 0 or the errno value of the failure
+    int open() noexcept
+    {
+        if(read_ >= 0)
+            return 0;
+        int fds[2];
+        if(::pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0)
+            return errno;
+        read_ = fds[0];
+        write_ = fds[1];
+        // A larger pipe means fewer round trips per transfer; best effort
+        int n = ::fcntl(write_, F_SETPIPE_SZ, 1024 * 1024);
+        size_ = n > 0 ? static_cast<std::size_t>(n) : 65536;
+        return 0;
+    }
+
+    void close() noexcept
+    {
+        if(read_ < 0)
+            return;
+        ::close(read_);
+        ::close(write_);
+        read_ = -1;
+        write_ = -1;
+    }
+};
+
+#endif
+
 } // detail
 } // co
 
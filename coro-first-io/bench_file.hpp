@@ -0,0 +1,546 @@
+//
+// Copyright (c) 2025 Vinnie Falco (vinnie dot falco at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/cppalliance/wg21-papers/coro-first-io
+//
+
+#ifndef BENCH_FILE_HPP
+#define BENCH_FILE_HPP
+
+#include "bench_co.hpp"
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/** A minimal io_uring driven by raw system calls.
+
+    Only what `co::file` needs is provided: one submission queue
+    entry at a time, submitted at once, and a completion queue drained
+    by the thread that owns the ring. No external library is used.
+*/
+namespace uring {
+
+class ring
+{
+public:
+    ring() = default;
+    ring(ring const&) = delete;
+    ring& operator=(ring const&) = delete;
+
+    ~ring()
+    {
+        close();
+    }
+
+    // Returns 0 or the errno value of the failure
+    int open(unsigned entries) noexcept
+    {
+        io_uring_params p{};
+        int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        if(fd < 0)
+            return errno;
+        fd_ = fd;
+        sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if(single)
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        sq_ = map(sq_size_, IORING_OFF_SQ_RING);
+        cq_ = single ? sq_ : map(cq_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = map(sqes_size_, IORING_OFF_SQES);
+        if(! sq_ || ! cq_ || ! sqes)
+        {
+            int e = errno;
+            if(sqes)
+                ::munmap(sqes, sqes_size_);
+            close();
+            return e;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+        auto* sq = static_cast<char*>(sq_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_flags_ = reinterpret_cast<unsigned*>(sq + p.sq_off.flags);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        auto* cq = static_cast<char*>(cq_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        return 0;
+    }
+
+    // The ring polls readable while completions are waiting
+    int native_handle() const noexcept
+    {
+        return fd_;
+    }
+
+    // Queues and submits one operation, returning 0 or an errno value
+    int submit(std::uint8_t opcode, int fd, void* addr, unsigned len,
+        std::uint64_t offset, void* user_data) noexcept
+    {
+        unsigned tail = *sq_tail_;
+        unsigned i = tail & sq_mask_;
+        io_uring_sqe& e = sqes_[i];
+        std::memset(&e, 0, sizeof(e));
+        e.opcode = opcode;
+        e.fd = fd;
+        e.addr = reinterpret_cast<std::uint64_t>(addr);
+        e.len = len;
+        e.off = offset;
+        e.user_data = reinterpret_cast<std::uint64_t>(user_data);
+        sq_array_[i] = i;
+        std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+        for(;;)
+        {
+            long n = enter(1, 0);
+            if(n > 0)
+                return 0;
+            if(n < 0 && errno == EINTR)
+                continue;
+            // The kernel consumed nothing, so take the entry back
+            int e = n == 0 ? EAGAIN : errno;
+            std::atomic_ref<unsigned>(*sq_tail_).store(tail, std::memory_order_release);
+            return e;
+        }
+    }
+
+    // Calls f(user_data, result) for each completion
+    template<class F>
+    void reap(F&& f) noexcept
+    {
+        // Completions that did not fit are flushed by entering the kernel
+        if(std::atomic_ref<unsigned>(*sq_flags_).load(std::memory_order_relaxed) & IORING_SQ_CQ_OVERFLOW)
+            enter(0, IORING_ENTER_GETEVENTS);
+        unsigned head = *cq_head_;
+        unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+        for(; head != tail; ++head)
+        {
+            auto const& c = cqes_[head & cq_mask_];
+            f(reinterpret_cast<void*>(c.user_data), c.res);
+        }
+        std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+    }
+
+private:
+    void* map(std::size_t size, long long offset) noexcept
+    {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    long enter(unsigned to_submit, unsigned flags) noexcept
+    {
+        return ::syscall(__NR_io_uring_enter, fd_, to_submit, 0, flags, nullptr, 0);
+    }
+
+    void close() noexcept
+    {
+        if(sqes_)
+            ::munmap(sqes_, sqes_size_);
+        if(cq_ && cq_ != sq_)
+            ::munmap(cq_, cq_size_);
+        if(sq_)
+            ::munmap(sq_, sq_size_);
+        if(fd_ >= 0)
+            ::close(fd_);
+        sqes_ = nullptr;
+        sq_ = cq_ = nullptr;
+        fd_ = -1;
+    }
+
+    int fd_ = -1;
+    void* sq_ = nullptr;
+    void* cq_ = nullptr;
+    std::size_t sq_size_ = 0;
+    std::size_t cq_size_ = 0;
+    std::size_t sqes_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_flags_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+} // uring
+
+//----------------------------------------------------------
+
+namespace co {
+
+namespace detail {
+
+// Threads which run blocking file operations for files without io_uring
+class blocking_pool
+{
+public:
+    explicit blocking_pool(unsigned n)
+    {
+        for(unsigned i = 0; i < n; ++i)
+            threads_.emplace_back([this]{ run(); });
+    }
+
+    ~blocking_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for(auto& t : threads_)
+            t.join();
+    }
+
+    void post(work* w)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_);
+            q_.push(w);
+        }
+        cv_.notify_one();
+    }
+
+    // Enough threads to keep a deep queue of page-cache misses busy
+    static blocking_pool& shared()
+    {
+        static blocking_pool pool(std::clamp(
+            2 * std::thread::hardware_concurrency(), 4u, 64u));
+        return pool;
+    }
+
+private:
+    void run()
+    {
+        for(;;)
+        {
+            work* w;
+            {
+                std::unique_lock<std::mutex> lock(m_);
+                cv_.wait(lock, [this]{ return stop_ || ! q_.empty(); });
+                if(q_.empty())
+                    return;
+                w = q_.pop();
+            }
+            (*w)();
+        }
+    }
+
+    std::mutex m_;
+    std::condition_variable cv_;
+    work_queue q_;
+    bool stop_ = false;
+    std::vector<std::thread> threads_;
+};
+
+} // detail
+
+/** A file with asynchronous positional reads and writes.
+
+    Operations are submitted through io_uring when the kernel allows
+    it, or else run on a shared pool of threads making blocking calls,
+    so that an event loop thread never blocks on the disk. Either way
+    completions are collected on the thread that awaits them and each
+    coroutine resumes through its caller's executor.
+
+    The state of an operation lives in its awaitable, inside the
+    awaiting coroutine's frame, so operations allocate nothing. While
+    operations are in flight the file waits for completions through
+    `any_executor::post_when_ready`, which also keeps `io_context::run`
+    from returning.
+
+    A file is used from one thread at a time, and must outlive its
+    operations. With io_uring, a file may hold more than `queue_depth`
+    operations in flight only if the kernel keeps completions that
+    overflow the completion queue (`IORING_FEAT_NODROP`, Linux 5.5);
+    older kernels drop them, and their coroutines never resume.
+
+    @par Example
+    @code
+    co::file f(fd);
+    char buf[4096];
+    std::size_t n = co_await f.async_read_at(0, buf, sizeof(buf));
+    @endcode
+*/
+class file
+{
+public:
+    enum class backend
+    {
+        io_uring,
+        thread_pool
+    };
+
+    /** Operation state shared by reads and writes.
+    */
+    struct io_op : work
+    {
+        io_op(file& f, std::uint64_t offset, void* data, std::size_t size, bool write) noexcept
+            : f_(&f), data_(data), size_(size), offset_(offset), write_(write) {}
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        std::coroutine_handle<> await_suspend(coro h, any_executor const& ex)
+        {
+            h_ = h;
+            ex_ = &ex;
+            f_->submit(*this);
+            return std::noop_coroutine();
+        }
+
+        // Returns the number of bytes transferred, which is short at end of file
+        std::size_t await_resume() const
+        {
+            if(result_ < 0)
+                throw std::system_error(static_cast<int>(-result_), std::generic_category());
+            return static_cast<std::size_t>(result_);
+        }
+
+        // Embedded in the awaitable, in the awaiting frame
+        void destroy() noexcept override {}
+
+        // Runs the blocking call on a pool thread, then resumes the
+        // coroutine when posted back to its executor
+        void operator()() override
+        {
+            if(done_)
+            {
+                ex_->dispatch(h_)();
+                return;
+            }
+            auto off = static_cast<::off_t>(offset_);
+            ::ssize_t r = write_ ? ::pwrite(f_->fd_, data_, size_, off)
+                                 : ::pread(f_->fd_, data_, size_, off);
+            result_ = r < 0 ? -errno : r;
+            done_ = true;
+            f_->complete_remote(*this);
+        }
+
+    private:
+        friend class file;
+
+        file* f_;
+        coro h_;
+        any_executor const* ex_ = nullptr;
+        void* data_;
+        std::size_t size_;
+        std::uint64_t offset_;
+        long result_ = 0;
+        bool write_;
+        bool done_ = false;
+    };
+
+    struct async_read_at_t : io_op
+    {
+        async_read_at_t(file& f, std::uint64_t offset, void* data, std::size_t size) noexcept
+            : io_op(f, offset, data, size, false) {}
+    };
+
+    struct async_write_at_t : io_op
+    {
+        async_write_at_t(file& f, std::uint64_t offset, void const* data, std::size_t size) noexcept
+            : io_op(f, offset, const_cast<void*>(data), size, true) {}
+    };
+
+    /** Constructs a file for a native descriptor.
+
+        The caller keeps ownership of the descriptor and must keep it
+        open for the life of the file.
+
+        @param fd A descriptor open for the operations to be performed.
+        @param queue_depth The number of io_uring submission entries.
+        @param b The preferred backend. If io_uring is unavailable the
+        thread pool is used instead; see `get_backend`.
+    */
+    explicit file(int fd, unsigned queue_depth = 128, backend b = backend::io_uring)
+        : fd_(fd)
+    {
+        if(b == backend::io_uring && ring_.open(queue_depth) == 0)
+        {
+            backend_ = backend::io_uring;
+            return;
+        }
+        event_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(event_fd_ < 0)
+            throw std::system_error(errno, std::generic_category());
+    }
+
+    file(file const&) = delete;
+    file& operator=(file const&) = delete;
+
+    ~file()
+    {
+        if(event_fd_ >= 0)
+            ::close(event_fd_);
+    }
+
+    backend get_backend() const noexcept
+    {
+        return backend_;
+    }
+
+    int native_handle() const noexcept
+    {
+        return fd_;
+    }
+
+    /** Reads from the file at an offset, as `pread` does.
+
+        @param offset The offset in the file to read from.
+        @param data The buffer to fill; must stay valid until completion.
+        @param size The size of the buffer.
+    */
+    async_read_at_t async_read_at(std::uint64_t offset, void* data, std::size_t size) noexcept
+    {
+        return { *this, offset, data, size };
+    }
+
+    /** Writes to the file at an offset, as `pwrite` does.
+
+        @param offset The offset in the file to write at.
+        @param data The bytes to write; must stay valid until completion.
+        @param size The number of bytes to write.
+    */
+    async_write_at_t async_write_at(std::uint64_t offset, void const* data, std::size_t size) noexcept
+    {
+        return { *this, offset, data, size };
+    }
+
+private:
+    // Collects completions on the thread that runs the operations
+    struct reaper : work
+    {
+        file* f_;
+        any_executor const* ex_ = nullptr;
+
+        explicit reaper(file* f) noexcept
+            : f_(f) {}
+
+        // A member of the file
+        void destroy() noexcept override {}
+
+        void operator()() override
+        {
+            f_->reap();
+        }
+    };
+
+    void submit(io_op& op)
+    {
+        ++g_io_count;
+        ++in_flight_;
+        if(backend_ == backend::thread_pool)
+            detail::blocking_pool::shared().post(&op);
+        else
+        {
+            // A single io_uring operation moves less than 2 GiB, like read()
+            auto len = static_cast<unsigned>(std::min<std::size_t>(op.size_, 0x7ffff000));
+            int e = ring_.submit(op.write_ ? IORING_OP_WRITE : IORING_OP_READ,
+                fd_, op.data_, len, op.offset_, &op);
+            if(e != 0)
+            {
+                --in_flight_;
+                op.result_ = -e;
+                op.done_ = true;
+                op.ex_->post(&op);
+                return;
+            }
+        }
+        arm(*op.ex_);
+    }
+
+    // Called on a pool thread; only an empty queue needs a signal
+    void complete_remote(io_op& op) noexcept
+    {
+        if(! done_.push(&op))
+            return;
+        std::uint64_t one = 1;
+        [[maybe_unused]] auto n = ::write(event_fd_, &one, sizeof(one));
+    }
+
+    void arm(any_executor const& ex)
+    {
+        if(armed_)
+            return;
+        armed_ = true;
+        reaper_.ex_ = &ex;
+        int fd = backend_ == backend::io_uring ? ring_.native_handle() : event_fd_;
+        if(! ex.post_when_ready(&reaper_, fd, wait_type::read))
+            ex.post(&reaper_);
+    }
+
+    void reap()
+    {
+        armed_ = false;
+        auto complete = [this](io_op& op)
+        {
+            --in_flight_;
+            op.ex_->post(&op);
+        };
+        if(backend_ == backend::io_uring)
+        {
+            ring_.reap([&](void* p, int res)
+            {
+                auto& op = *static_cast<io_op*>(p);
+                op.result_ = res;
+                op.done_ = true;
+                complete(op);
+            });
+        }
+        else
+        {
+            // Clear the signal before taking, so a later push signals again
+            std::uint64_t n;
+            [[maybe_unused]] auto r = ::read(event_fd_, &n, sizeof(n));
+            work_queue q;
+            done_.take(q);
+            while(work* w = q.pop())
+                complete(*static_cast<io_op*>(w));
+        }
+        if(in_flight_ > 0)
+            arm(*reaper_.ex_);
+    }
+
+    int fd_;
+    backend backend_ = backend::thread_pool;
+    uring::ring ring_;
+    int event_fd_ = -1;
+    remote_queue done_;
+    reaper reaper_{this};
+    std::size_t in_flight_ = 0;
+    bool armed_ = false;
+};
+
+} // co
+
+#endif
+
+#endif
@@ -0,0 +1,207 @@
+//
+// Copyright (c) 2025 Vinnie Falco (vinnie dot falco at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/cppalliance/wg21-papers/coro-first-io
+//
+
+#ifndef BENCH_GEN_HPP
+#define BENCH_GEN_HPP
+
+#include "bench_cb.hpp"
+#include "bench_co.hpp"
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/** The shape of a generated composed operation.
+
+    A generated operation is a tree of nested operations `depth` levels
+    deep. Each level runs `fanout` steps in sequence; a step at the
+    deepest level is one `async_read_some`, and a step at any other
+    level is a whole operation one level down, so an operation performs
+    `fanout` to the power `depth` reads. Every level keeps `state` bytes
+    of local state alive across its suspensions and spins for `work`
+    iterations over that state before each step. The state size is a
+    template parameter of each level, so only the sizes accepted by
+    `valid_state` are compiled in.
+
+    @see cb::async_generated
+    @see co::async_generated
+*/
+struct workload_shape
+{
+    static constexpr int max_depth = 32;
+
+    int depth = 1;
+    int fanout = 1;
+    std::size_t state = 0;
+    int work = 0;
+
+    // Returns the number of reads one operation performs, or 0 if it overflows limit
+    std::size_t reads(std::size_t limit) const noexcept
+    {
+        std::size_t n = 1;
+        for(int i = 0; i < depth; ++i)
+        {
+            if(n > limit / static_cast<std::size_t>(fanout))
+                return 0;
+            n *= static_cast<std::size_t>(fanout);
+        }
+        return n;
+    }
+
+    // Per-step CPU work over the level's state that the optimizer cannot remove
+    template<std::size_t State>
+    static void spin(int work, std::array<unsigned char, State>& state) noexcept
+    {
+        [[maybe_unused]] static thread_local volatile unsigned sink;
+        unsigned x = 0;
+        for(int i = 0; i < work; ++i)
+        {
+            if constexpr(State > 0)
+                x = x * 31 + state[static_cast<std::size_t>(i) % State]++;
+            else
+                x = x * 31 + static_cast<unsigned>(i);
+        }
+        sink = x;
+    }
+
+    // True for the compiled-in state sizes: 0, 64, 256 and 1024
+    static constexpr bool valid_state(std::size_t n) noexcept
+    {
+        return n == 0 || n == 64 || n == 256 || n == 1024;
+    }
+
+    // Calls f with the compiled-in state size n, which must be valid
+    template<class F>
+    static decltype(auto) with_state_size(std::size_t n, F&& f)
+    {
+        switch(n)
+        {
+        case 0: return f(std::integral_constant<std::size_t, 0>{});
+        case 64: return f(std::integral_constant<std::size_t, 64>{});
+        case 256: return f(std::integral_constant<std::size_t, 256>{});
+        case 1024: return f(std::integral_constant<std::size_t, 1024>{});
+        default: throw std::invalid_argument("unsupported workload_shape::state");
+        }
+    }
+};
+
+//----------------------------------------------------------
+
+namespace cb {
+
+namespace detail {
+
+// One level of a generated operation. The level is part of the type so
+// the nested chain is instantiated once up to max_depth and shared by
+// every depth; the shape decides at run time where the chain ends
+template<class Stream, class Handler, std::size_t State, int Level>
+struct gen_op
+{
+    Stream* stream_;
+    Handler handler_;
+    workload_shape const* shape_;
+    int count_ = 0;
+    std::array<unsigned char, State> state_{};
+
+    gen_op(Stream& stream, Handler h, workload_shape const& shape)
+        : stream_(&stream), handler_(std::move(h)), shape_(&shape) {}
+
+    auto get_allocator() const noexcept
+    {
+        return get_associated_allocator(handler_);
+    }
+
+    void operator()()
+    {
+        if(count_++ < shape_->fanout)
+        {
+            workload_shape::spin(shape_->work, state_);
+            if constexpr(Level < workload_shape::max_depth)
+            {
+                if(Level < shape_->depth)
+                {
+                    auto& stream = *stream_;
+                    auto const& shape = *shape_;
+                    gen_op<Stream, gen_op, State, Level + 1>(
+                        stream, std::move(*this), shape)();
+                    return;
+                }
+            }
+            stream_->async_read_some(std::move(*this));
+            return;
+        }
+        handler_();
+    }
+};
+
+} // detail
+
+/** Performs a generated composed operation on a stream.
+
+    @param stream The stream to read from.
+    @param shape The shape of the operation; must outlive it.
+    @param handler The completion handler to invoke when done.
+
+    @see workload_shape
+*/
+template<class Stream, class Handler>
+void async_generated(Stream& stream, workload_shape const& shape, Handler&& handler)
+{
+    workload_shape::with_state_size(shape.state, [&](auto state)
+    {
+        detail::gen_op<Stream, std::decay_t<Handler>, decltype(state)::value, 1>(
+            stream, std::forward<Handler>(handler), shape)();
+    });
+}
+
+} // cb
+
+//----------------------------------------------------------
+
+namespace co {
+
+namespace detail {
+
+template<std::size_t State, class Stream>
+task gen_task(Stream& stream, workload_shape const& shape, int level)
+{
+    std::array<unsigned char, State> state{};
+    for(int i = 0; i < shape.fanout; ++i)
+    {
+        workload_shape::spin(shape.work, state);
+        if(level < shape.depth)
+            co_await gen_task<State>(stream, shape, level + 1);
+        else
+            co_await stream.async_read_some();
+    }
+}
+
+} // detail
+
+/** Returns a task performing a generated composed operation on a stream.
+
+    @param stream The stream to read from.
+    @param shape The shape of the operation; must outlive the task.
+
+    @see workload_shape
+*/
+template<class Stream>
+task async_generated(Stream& stream, workload_shape const& shape)
+{
+    return workload_shape::with_state_size(shape.state, [&](auto state)
+    {
+        return detail::gen_task<decltype(state)::value>(stream, shape, 1);
+    });
+}
+
+} // co
+
+#endif
@@ -0,0 +1,286 @@
+//
+// Copyright (c) 2025 Vinnie Falco (vinnie dot falco at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/cppalliance/wg21-papers/coro-first-io
+//
+
+#ifndef BENCH_MMAP_HPP
+#define BENCH_MMAP_HPP
+
+#include "bench_cb.hpp"
+#include "bench_co.hpp"
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** A read-only memory mapping of a whole file.
+
+    The mapping is advised for sequential access, so the kernel reads
+    ahead aggressively and drops pages behind the reader. Streams over
+    the mapping share it; it must outlive them.
+
+    @see co::mmap_stream
+    @see cb::mmap_stream
+*/
+class mapped_file
+{
+public:
+    /** Maps the file a descriptor refers to.
+
+        The caller keeps ownership of the descriptor, which may be
+        closed once the mapping exists.
+    */
+    explicit mapped_file(int fd)
+    {
+        map(fd);
+    }
+
+    /** Opens and maps the file at `path`.
+    */
+    explicit mapped_file(char const* path)
+    {
+        int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            throw std::system_error(errno, std::generic_category());
+        try
+        {
+            map(fd);
+        }
+        catch(...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+    }
+
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+
+    ~mapped_file()
+    {
+        if(size_ != 0)
+            ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    std::string_view view() const noexcept
+    {
+        return { data_, size_ };
+    }
+
+    // A read position in a mapping which asks the kernel to fault in
+    // the next window before the reader gets there
+    class cursor
+    {
+    public:
+        // Bytes advised with MADV_WILLNEED at a time; a multiple of the page size
+        static constexpr std::size_t window = std::size_t(4) * 1024 * 1024;
+
+        cursor(mapped_file const& f, std::size_t chunk) noexcept
+            : data_(f.view()), chunk_(chunk)
+        {
+            advise();
+        }
+
+        std::size_t remaining() const noexcept
+        {
+            return data_.size() - pos_;
+        }
+
+        // Returns up to one chunk and moves past it; empty at the end
+        std::string_view take() noexcept
+        {
+            auto v = data_.substr(pos_, chunk_);
+            pos_ += v.size();
+            if(advised_ < data_.size() && pos_ + window / 2 > advised_)
+                advise();
+            return v;
+        }
+
+    private:
+        void advise() noexcept
+        {
+            if(advised_ >= data_.size())
+                return;
+            auto n = std::min(window, data_.size() - advised_);
+            ::madvise(const_cast<char*>(data_.data() + advised_), n, MADV_WILLNEED);
+            advised_ += n;
+        }
+
+        std::string_view data_;
+        std::size_t chunk_;
+        std::size_t pos_ = 0;
+        std::size_t advised_ = 0;
+    };
+
+private:
+    void map(int fd)
+    {
+        struct stat st;
+        if(::fstat(fd, &st) != 0)
+            throw std::system_error(errno, std::generic_category());
+        size_ = static_cast<std::size_t>(st.st_size);
+        if(size_ == 0)
+            return;
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p == MAP_FAILED)
+            throw std::system_error(errno, std::generic_category());
+        ::madvise(p, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<char const*>(p);
+    }
+
+    char const* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+//----------------------------------------------------------
+
+namespace co {
+
+/** A stream reading a memory-mapped file, usable wherever `co::socket` is.
+
+    `async_read_some()` yields a view of up to `chunk` bytes of the
+    mapping, copying nothing. While mapped data remains the awaitable
+    is ready at once, so reads complete without suspending and without
+    touching the executor. At the end of the file a read completes
+    through the executor, as a socket read at end of stream would, and
+    yields an empty view.
+
+    @par Example
+    @code
+    mapped_file f("capture.bin");
+    co::mmap_stream s(f);
+    co_await co::async_session(s);
+    @endcode
+*/
+class mmap_stream
+{
+public:
+    struct async_read_some_t : work
+    {
+        explicit async_read_some_t(mmap_stream& s) noexcept
+            : s_(&s) {}
+
+        bool await_ready() const noexcept
+        {
+            return s_->cursor_.remaining() != 0;
+        }
+
+        std::coroutine_handle<> await_suspend(coro h, any_executor const& ex)
+        {
+            h_ = h;
+            ex_ = &ex;
+            ex.post(this);
+            return std::noop_coroutine();
+        }
+
+        std::string_view await_resume() noexcept
+        {
+            ++g_io_count;
+            return s_->cursor_.take();
+        }
+
+        // Embedded in the awaitable, in the awaiting frame
+        void destroy() noexcept override {}
+
+        void operator()() override
+        {
+            ex_->dispatch(h_)();
+        }
+
+    private:
+        mmap_stream* s_;
+        coro h_;
+        any_executor const* ex_ = nullptr;
+    };
+
+    explicit mmap_stream(mapped_file const& f, std::size_t chunk = 4096) noexcept
+        : cursor_(f, chunk)
+    {
+    }
+
+    async_read_some_t async_read_some() noexcept
+    {
+        return async_read_some_t(*this);
+    }
+
+    detail::frame_pool& get_frame_allocator()
+    {
+        return pool_;
+    }
+
+private:
+    mapped_file::cursor cursor_;
+    detail::frame_pool pool_;
+};
+
+} // co
+
+//----------------------------------------------------------
+
+namespace cb {
+
+/** A stream reading a memory-mapped file, usable wherever `cb::socket` is.
+
+    Completion handlers take no arguments, so the view produced by the
+    last read is available from `buffer()`. Unlike the coroutine
+    stream, every read is posted to the executor even while data
+    remains: invoking the handler inline would let a composed
+    operation recurse once per read.
+
+    @tparam Executor The executor type used for completion.
+*/
+template<class Executor>
+class mmap_stream
+{
+public:
+    mmap_stream(Executor ex, mapped_file const& f, std::size_t chunk = 4096) noexcept
+        : ex_(ex), cursor_(f, chunk)
+    {
+    }
+
+    Executor get_executor() const { return ex_; }
+
+    template<class Handler>
+    void async_read_some(Handler&& handler)
+    {
+        ++g_io_count;
+        last_ = cursor_.take();
+        using op_t = detail::io_op<Executor, std::decay_t<Handler>>;
+        auto alloc = get_associated_allocator(handler);
+        void* p = alloc.allocate(sizeof(op_t));
+        ex_.post(::new(p) op_t(ex_, std::forward<Handler>(handler)));
+    }
+
+    // The view yielded by the last read; empty at the end of the file
+    std::string_view buffer() const noexcept
+    {
+        return last_;
+    }
+
+private:
+    Executor ex_;
+    mapped_file::cursor cursor_;
+    std::string_view last_;
+};
+
+} // cb
+
+#endif
+
+#endif
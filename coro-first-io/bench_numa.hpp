@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2025 Vinnie Falco (vinnie dot falco at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/cppalliance/wg21-papers/coro-first-io
+//
+
+#ifndef BENCH_NUMA_HPP
+#define BENCH_NUMA_HPP
+
+#include "bench_affinity.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/** Minimal NUMA topology queries without external libraries.
+
+    On Linux the topology is read from sysfs and the current node
+    from the `getcpu` system call. On other platforms the machine
+    is reported as a single node and binding is a no-op.
+
+    Each thread has a "memory node", which `frame_pool` uses to keep
+    coroutine frames on the node that allocated them. It defaults to
+    the node the thread first asked from, and is changed by `bind_thread`.
+*/
+namespace numa {
+
+namespace detail {
+
+struct thread_state
+{
+    unsigned node = 0;
+    bool known = false;
+    bool bound = false;
+};
+
+inline thread_state& state() noexcept
+{
+    static thread_local thread_state s;
+    return s;
+}
+
+} // detail
+
+/** Returns the number of NUMA nodes, at least one.
+*/
+inline unsigned node_count()
+{
+    static unsigned const n = []
+    {
+        auto nodes = affinity::detail::read_list("/sys/devices/system/node/online");
+        return nodes.empty() ? 1u : nodes.back() + 1;
+    }();
+    return n;
+}
+
+/** Returns the CPUs belonging to a node, or an empty list if unknown.
+*/
+inline std::vector<unsigned> node_cpus(unsigned node)
+{
+    std::string path = "/sys/devices/system/node/node" +
+        std::to_string(node) + "/cpulist";
+    return affinity::detail::read_list(path.c_str());
+}
+
+/** Returns the node of the CPU the calling thread is running on.
+*/
+inline unsigned current_node() noexcept
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if(::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return node;
+#endif
+    return 0;
+}
+
+/** Returns the memory node of the calling thread.
+
+    The first call on a thread samples `current_node()`; after that
+    the value only changes through `bind_thread` or `set_thread_node`.
+*/
+inline unsigned thread_node() noexcept
+{
+    auto& s = detail::state();
+    if(! s.known)
+    {
+        s.node = current_node();
+        s.known = true;
+    }
+    return s.node;
+}
+
+/** Sets the memory node of the calling thread without moving it.
+*/
+inline void set_thread_node(unsigned node) noexcept
+{
+    auto& s = detail::state();
+    s.node = node;
+    s.known = true;
+}
+
+/** Restricts the calling thread to the CPUs of a node.
+
+    The thread's memory node is left unchanged.
+
+    @return `true` if the thread's CPU affinity was changed.
+*/
+inline bool pin_thread(unsigned node)
+{
+    return affinity::pin_this_thread(node_cpus(node));
+}
+
+/** Pins the calling thread to a node and makes it the thread's memory node.
+
+    Memory first touched by the thread afterwards is placed on the
+    node by the kernel's default policy, and `frame_pool` refills come
+    from that node's slabs. Repeated calls with the same node are cheap.
+
+    @return `true` if the thread's CPU affinity was changed.
+*/
+inline bool bind_thread(unsigned node)
+{
+    auto& s = detail::state();
+    if(s.bound && s.known && s.node == node)
+        return true;
+    set_thread_node(node);
+    s.bound = pin_thread(node);
+    return s.bound;
+}
+
+} // numa
+
+#endif
@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2025 Vinnie Falco (vinnie dot falco at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/cppalliance/wg21-papers/coro-first-io
+//
+
+#ifndef BENCH_PERF_HPP
+#define BENCH_PERF_HPP
+
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/** A hardware event counter for the calling thread.
+
+    On Linux this wraps `perf_event_open`. The counter is invalid when
+    the platform, the kernel's `perf_event_paranoid` setting, or the
+    virtual machine does not expose the event; `stop()` then returns -1
+    so reports can print "n/a" instead of a misleading zero.
+
+    @par Example
+    @code
+    auto c = perf_counter::dtlb_load_misses();
+    c.start();
+    run_workload();
+    long long misses = c.stop();
+    @endcode
+*/
+class perf_counter
+{
+    int fd_ = -1;
+
+public:
+    perf_counter(std::uint32_t type, std::uint64_t config) noexcept
+    {
+#if defined(__linux__)
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void)type;
+        (void)config;
+#endif
+    }
+
+    ~perf_counter()
+    {
+#if defined(__linux__)
+        if(fd_ >= 0)
+            ::close(fd_);
+#endif
+    }
+
+    perf_counter(perf_counter&& other) noexcept
+        : fd_(other.fd_)
+    {
+        other.fd_ = -1;
+    }
+
+    perf_counter& operator=(perf_counter&&) = delete;
+
+    /** Returns a counter of data TLB misses on loads.
+    */
+    static perf_counter dtlb_load_misses() noexcept
+    {
+#if defined(__linux__)
+        return perf_counter(PERF_TYPE_HW_CACHE,
+            PERF_COUNT_HW_CACHE_DTLB |
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#else
+        return perf_counter(0, 0);
+#endif
+    }
+
+    bool valid() const noexcept { return fd_ >= 0; }
+
+    void start() noexcept
+    {
+#if defined(__linux__)
+        if(fd_ < 0)
+            return;
+        ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    // Returns the events counted since start(), or -1 if unavailable
+    long long stop() noexcept
+    {
+#if defined(__linux__)
+        if(fd_ < 0)
+            return -1;
+        ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        long long v = 0;
+        if(::read(fd_, &v, sizeof(v)) != sizeof(v))
+            return -1;
+        return v;
+#else
+        return -1;
+#endif
+    }
+};
+
+#endif
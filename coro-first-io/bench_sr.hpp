@@ -0,0 +1,219 @@
+//
+// Copyright (c) 2025 Vinnie Falco (vinnie dot falco at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/cppalliance/wg21-papers/coro-first-io
+//
+
+#ifndef BENCH_SR_HPP
+#define BENCH_SR_HPP
+
+#include "bench.hpp"
+#include "bench_sr_detail.hpp"
+
+#include <utility>
+
+/** A minimal sender/receiver model in the style of P2300.
+
+    A sender describes work; `connect(receiver)` returns an immovable
+    operation state whose `start()` begins it. A receiver has
+    `set_value()`, `set_error(std::exception_ptr)` and `set_stopped()`.
+    Adaptors nest the operation states of the senders they wrap, so a
+    composed operation is one object that the caller places where it
+    likes, typically on the stack.
+
+    Only the parts the benchmark exercises are provided. Senders here
+    complete with no values and omit completion signatures, environments
+    and schedulers; the socket posts to its executor as the other
+    styles do.
+*/
+namespace sr {
+
+/** A sender which completes inline with no value.
+*/
+struct just_sender
+{
+    template<class Receiver>
+    detail::just_op<Receiver> connect(Receiver r) const
+    {
+        return { std::move(r) };
+    }
+};
+
+inline just_sender just() noexcept
+{
+    return {};
+}
+
+/** A sender which calls a function when another sender completes.
+
+    @see then
+*/
+template<class Sender, class F>
+struct then_sender
+{
+    Sender s_;
+    F f_;
+
+    template<class Receiver>
+    auto connect(Receiver r) const
+    {
+        return s_.connect(detail::then_receiver<F, Receiver>{ f_, std::move(r) });
+    }
+};
+
+template<class Sender, class F>
+then_sender<Sender, F> then(Sender s, F f)
+{
+    return { std::move(s), std::move(f) };
+}
+
+/** A sender which continues with the sender a function returns.
+
+    When `s` completes, `f()` is called and the sender it returns is
+    connected and started. Its operation state is built inside the
+    enclosing one, so no allocation takes place.
+
+    @see let_value
+*/
+template<class Sender, class F>
+struct let_value_sender
+{
+    Sender s_;
+    F f_;
+
+    template<class Receiver>
+    detail::let_value_op<Sender, F, Receiver> connect(Receiver r) const
+    {
+        return { s_, f_, std::move(r) };
+    }
+};
+
+template<class Sender, class F>
+let_value_sender<Sender, F> let_value(Sender s, F f)
+{
+    return { std::move(s), std::move(f) };
+}
+
+/** A sender which runs another sender `n` times in sequence.
+
+    Each iteration connects a fresh copy of the sender into the same
+    storage inside the enclosing operation state.
+
+    @see repeat_n
+*/
+template<class Sender>
+struct repeat_n_sender
+{
+    Sender s_;
+    int n_;
+
+    template<class Receiver>
+    detail::repeat_n_op<Sender, Receiver> connect(Receiver r) const
+    {
+        return { s_, n_, std::move(r) };
+    }
+};
+
+template<class Sender>
+repeat_n_sender<Sender> repeat_n(Sender s, int n)
+{
+    return { std::move(s), n };
+}
+
+//----------------------------------------------------------
+
+/** A simulated asynchronous socket for benchmarking senders.
+
+    `async_read_some()` returns a sender whose operation state is the
+    work item posted to the executor, so a read costs no allocation.
+
+    @tparam Executor The executor type used for completion.
+*/
+template<class Executor>
+struct socket
+{
+    struct read_some_sender
+    {
+        Executor ex_;
+
+        template<class Receiver>
+        detail::read_some_op<Executor, Receiver> connect(Receiver r) const
+        {
+            return { ex_, std::move(r) };
+        }
+    };
+
+    Executor ex_;
+
+    explicit socket(Executor ex)
+        : ex_(ex) {}
+
+    Executor get_executor() const { return ex_; }
+
+    read_some_sender async_read_some() const
+    {
+        return { ex_ };
+    }
+};
+
+/** A TLS stream adapter that wraps another stream.
+
+    `async_read_some()` adapts one read of the wrapped stream,
+    simulating TLS record layer behavior.
+
+    @tparam Stream The stream type to wrap.
+*/
+template<class Stream>
+struct tls_stream
+{
+    Stream stream_;
+
+    template<class... Args>
+    explicit tls_stream(Args&&... args)
+        : stream_(std::forward<Args>(args)...) {}
+
+    auto get_executor() const { return stream_.get_executor(); }
+
+    auto async_read_some() const
+    {
+        return then(stream_.async_read_some(), []() noexcept {});
+    }
+};
+
+//----------------------------------------------------------
+
+/** Returns a sender performing 5 sequential read_some operations.
+*/
+template<class Stream>
+auto async_read(Stream& stream)
+{
+    return repeat_n(stream.async_read_some(), 5);
+}
+
+/** Returns a sender performing 10 sequential read_some operations.
+*/
+template<class Stream>
+auto async_request(Stream& stream)
+{
+    return repeat_n(stream.async_read_some(), 10);
+}
+
+/** Returns a sender performing 100 sequential requests.
+
+    Each request is produced by `let_value` when the previous one
+    completes, the way a protocol decides at run time what to read next.
+*/
+template<class Stream>
+auto async_session(Stream& stream)
+{
+    return repeat_n(
+        let_value(just(), [&stream]{ return async_request(stream); }),
+        100);
+}
+
+} // sr
+
+#endif
@@ -0,0 +1,249 @@
+//
+// Copyright (c) 2025 Vinnie Falco (vinnie dot falco at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/cppalliance/wg21-papers/coro-first-io
+//
+
+#ifndef BENCH_SR_DETAIL_HPP
+#define BENCH_SR_DETAIL_HPP
+
+#include "bench.hpp"
+
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sr {
+
+namespace detail {
+
+template<class Sender, class Receiver>
+using connect_result_t = decltype(
+    std::declval<Sender const&>().connect(std::declval<Receiver>()));
+
+// Storage for an operation state constructed and destroyed by hand.
+// Operation states are immovable, so they are emplaced from the
+// prvalue returned by connect
+template<class T>
+struct manual_lifetime
+{
+    alignas(T) unsigned char buf_[sizeof(T)];
+
+    template<class F>
+    T& emplace_from(F&& f)
+    {
+        return *::new(static_cast<void*>(buf_)) T(std::forward<F>(f)());
+    }
+
+    T& get() noexcept
+    {
+        return *std::launder(reinterpret_cast<T*>(buf_));
+    }
+
+    void destroy() noexcept
+    {
+        get().~T();
+    }
+};
+
+// Forwards completions to a receiver owned by an enclosing operation
+template<class Receiver>
+struct ref_receiver
+{
+    Receiver* r_;
+
+    void set_value() noexcept { r_->set_value(); }
+    void set_error(std::exception_ptr e) noexcept { r_->set_error(std::move(e)); }
+    void set_stopped() noexcept { r_->set_stopped(); }
+};
+
+//----------------------------------------------------------
+
+template<class Executor, class Receiver>
+struct read_some_op : work
+{
+    Executor ex_;
+    Receiver r_;
+
+    read_some_op(Executor ex, Receiver r)
+        : ex_(ex), r_(std::move(r)) {}
+
+    read_some_op(read_some_op const&) = delete;
+    read_some_op& operator=(read_some_op const&) = delete;
+
+    void start() noexcept
+    {
+        ++g_io_count;
+        ex_.post(this);
+    }
+
+    // Owned by whoever connected the sender
+    void destroy() noexcept override {}
+
+    void operator()() override
+    {
+        // The receiver may destroy this operation, so it is the last access
+        r_.set_value();
+    }
+};
+
+template<class Receiver>
+struct just_op
+{
+    Receiver r_;
+
+    void start() noexcept
+    {
+        r_.set_value();
+    }
+};
+
+template<class F, class Receiver>
+struct then_receiver
+{
+    F f_;
+    Receiver r_;
+
+    void set_value() noexcept
+    {
+        f_();
+        r_.set_value();
+    }
+
+    void set_error(std::exception_ptr e) noexcept { r_.set_error(std::move(e)); }
+    void set_stopped() noexcept { r_.set_stopped(); }
+};
+
+//----------------------------------------------------------
+
+// Runs the sender returned by F after the first sender completes;
+// the second operation state is built in place inside this one
+template<class Sender, class F, class Receiver>
+struct let_value_op
+{
+    struct first_receiver
+    {
+        let_value_op* op_;
+
+        void set_value() noexcept { op_->start_second(); }
+        void set_error(std::exception_ptr e) noexcept { op_->r_.set_error(std::move(e)); }
+        void set_stopped() noexcept { op_->r_.set_stopped(); }
+    };
+
+    using second_sender = std::invoke_result_t<F&>;
+    using first_op = connect_result_t<Sender, first_receiver>;
+    using second_op = connect_result_t<second_sender, ref_receiver<Receiver>>;
+
+    F f_;
+    Receiver r_;
+    first_op first_;
+    manual_lifetime<second_op> second_;
+    bool started_ = false;
+
+    let_value_op(Sender const& s, F f, Receiver r)
+        : f_(std::move(f))
+        , r_(std::move(r))
+        , first_(s.connect(first_receiver{this}))
+    {
+    }
+
+    let_value_op(let_value_op const&) = delete;
+    let_value_op& operator=(let_value_op const&) = delete;
+
+    ~let_value_op()
+    {
+        if(started_)
+            second_.destroy();
+    }
+
+    void start() noexcept
+    {
+        first_.start();
+    }
+
+    void start_second() noexcept
+    {
+        auto s = f_();
+        second_.emplace_from([&]
+        {
+            return s.connect(ref_receiver<Receiver>{&r_});
+        });
+        started_ = true;
+        second_.get().start();
+    }
+};
+
+//----------------------------------------------------------
+
+// Connects and starts a fresh copy of the sender each iteration,
+// reusing the same storage for its operation state
+template<class Sender, class Receiver>
+struct repeat_n_op
+{
+    struct step_receiver
+    {
+        repeat_n_op* op_;
+
+        void set_value() noexcept
+        {
+            // Destroying the step also destroys this receiver
+            auto* op = op_;
+            op->step_.destroy();
+            op->next();
+        }
+
+        void set_error(std::exception_ptr e) noexcept
+        {
+            auto* op = op_;
+            op->step_.destroy();
+            op->r_.set_error(std::move(e));
+        }
+
+        void set_stopped() noexcept
+        {
+            auto* op = op_;
+            op->step_.destroy();
+            op->r_.set_stopped();
+        }
+    };
+
+    Sender s_;
+    Receiver r_;
+    int n_;
+    int count_ = 0;
+    manual_lifetime<connect_result_t<Sender, step_receiver>> step_;
+
+    repeat_n_op(Sender s, int n, Receiver r)
+        : s_(std::move(s)), r_(std::move(r)), n_(n) {}
+
+    repeat_n_op(repeat_n_op const&) = delete;
+    repeat_n_op& operator=(repeat_n_op const&) = delete;
+
+    void start() noexcept
+    {
+        next();
+    }
+
+    void next() noexcept
+    {
+        if(count_++ < n_)
+        {
+            step_.emplace_from([&]
+            {
+                return s_.connect(step_receiver{this});
+            });
+            step_.get().start();
+            return;
+        }
+        r_.set_value();
+    }
+};
+
+} // detail
+} // sr
+
+#endif
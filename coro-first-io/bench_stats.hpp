@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2025 Vinnie Falco (vinnie dot falco at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/cppalliance/wg21-papers/coro-first-io
+//
+
+#ifndef BENCH_STATS_HPP
+#define BENCH_STATS_HPP
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+/** A cycle counter for timestamping work items.
+
+    On x86 this reads the time stamp counter, which costs a few
+    nanoseconds and is synchronized across cores on processors with an
+    invariant TSC. Elsewhere it falls back to `steady_clock`, counting
+    nanoseconds.
+*/
+namespace tsc {
+
+inline std::uint64_t now() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<
+        std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Measured once against steady_clock, taking about 10ms on first use
+inline double ns_per_tick() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    static double const value = []
+    {
+        using clock = std::chrono::steady_clock;
+        auto t0 = clock::now();
+        auto c0 = now();
+        while(clock::now() - t0 < std::chrono::milliseconds(10))
+        {
+        }
+        auto c1 = now();
+        auto t1 = clock::now();
+        double ns = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        return ns / static_cast<double>(c1 - c0);
+    }();
+    return value;
+#else
+    return 1.0;
+#endif
+}
+
+inline double to_ns(std::uint64_t ticks) noexcept
+{
+    return static_cast<double>(ticks) * ns_per_tick();
+}
+
+inline std::uint64_t from_ns(std::chrono::nanoseconds d) noexcept
+{
+    return static_cast<std::uint64_t>(static_cast<double>(d.count()) / ns_per_tick());
+}
+
+} // tsc
+
+/** A histogram with logarithmic buckets in the style of HdrHistogram.
+
+    Each power of two is split into 16 linear sub-buckets, so any
+    recorded value is known to within about 6% over the full 64-bit
+    range. Recording is an index computation and an increment, with no
+    allocation or synchronization; keep one histogram per thread and
+    merge them to report.
+
+    @par Example
+    @code
+    log_histogram h;
+    h.record(latency);
+    auto p99 = h.percentile(99.0);
+    @endcode
+*/
+class log_histogram
+{
+public:
+    static constexpr unsigned sub_bits = 4;
+    static constexpr std::size_t sub_count = std::size_t(1) << sub_bits;
+    static constexpr std::size_t bucket_count = (64 - sub_bits + 1) * sub_count;
+
+    void record(std::uint64_t v) noexcept
+    {
+        ++counts_[index(v)];
+        ++total_;
+        max_ = std::max(max_, v);
+    }
+
+    void merge(log_histogram const& other) noexcept
+    {
+        for(std::size_t i = 0; i < bucket_count; ++i)
+            counts_[i] += other.counts_[i];
+        total_ += other.total_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() noexcept
+    {
+        *this = log_histogram();
+    }
+
+    std::uint64_t count() const noexcept
+    {
+        return total_;
+    }
+
+    std::uint64_t max() const noexcept
+    {
+        return max_;
+    }
+
+    // Returns the highest value of the bucket holding the given
+    // percentile, using the nearest rank
+    std::uint64_t percentile(double p) const noexcept
+    {
+        if(total_ == 0)
+            return 0;
+        auto rank = static_cast<std::uint64_t>(std::ceil(p / 100.0 * static_cast<double>(total_)));
+        rank = std::clamp<std::uint64_t>(rank, 1, total_);
+        std::uint64_t seen = 0;
+        for(std::size_t i = 0; i < bucket_count; ++i)
+        {
+            seen += counts_[i];
+            if(seen >= rank)
+                return std::min(highest(i), max_);
+        }
+        return max_;
+    }
+
+private:
+    static std::size_t index(std::uint64_t v) noexcept
+    {
+        if(v < sub_count)
+            return static_cast<std::size_t>(v);
+        unsigned e = static_cast<unsigned>(std::bit_width(v)) - 1;
+        auto sub = static_cast<std::size_t>(v >> (e - sub_bits)) & (sub_count - 1);
+        return (e - sub_bits + 1) * sub_count + sub;
+    }
+
+    static std::uint64_t highest(std::size_t i) noexcept
+    {
+        if(i < sub_count)
+            return i;
+        unsigned e = static_cast<unsigned>(i / sub_count) + sub_bits - 1;
+        std::uint64_t sub = i % sub_count;
+        std::uint64_t lowest = (sub_count + sub) << (e - sub_bits);
+        return lowest + ((std::uint64_t(1) << (e - sub_bits)) - 1);
+    }
+
+    std::uint64_t counts_[bucket_count] = {};
+    std::uint64_t total_ = 0;
+    std::uint64_t max_ = 0;
+};
+
+#endif
@@ -0,0 +1,702 @@
+//
+// Copyright (c) 2025 Vinnie Falco (vinnie dot falco at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/cppalliance/wg21-papers/coro-first-io
+//
+
+#ifndef BENCH_TRACE_HPP
+#define BENCH_TRACE_HPP
+
+#include "bench_mmap.hpp"
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/** Traces of stream reads, for replaying captured traffic.
+
+    A trace file is the 8-byte magic `CFIOTRC1` followed by one record
+    per completed read: the nanoseconds since the previous read
+    completed and the number of bytes read, each as an unsigned LEB128
+    varint, then the bytes themselves. A read of a stream which yields
+    no bytes, such as the simulated sockets, is recorded with a length
+    of zero, which keeps its timing. The end of a trace is not a
+    record: a replay stream reports it through `at_end()`, so an empty
+    read is never mistaken for it.
+
+    @see co::recording_stream
+    @see co::replay_stream
+*/
+namespace trace {
+
+inline constexpr char magic[8] = { 'C', 'F', 'I', 'O', 'T', 'R', 'C', '1' };
+
+/** Appends records to a trace file.
+*/
+class writer
+{
+public:
+    explicit writer(char const* path)
+        : f_(std::fopen(path, "wb"))
+    {
+        if(! f_)
+            throw std::system_error(errno, std::generic_category());
+        std::fwrite(magic, 1, sizeof(magic), f_);
+    }
+
+    writer(writer const&) = delete;
+    writer& operator=(writer const&) = delete;
+
+    ~writer()
+    {
+        std::fclose(f_);
+    }
+
+    void record(std::chrono::nanoseconds delay, std::string_view bytes)
+    {
+        put(static_cast<std::uint64_t>(std::max<std::chrono::nanoseconds::rep>(delay.count(), 0)));
+        put(bytes.size());
+        if(! bytes.empty() && std::fwrite(bytes.data(), 1, bytes.size(), f_) != bytes.size())
+            throw std::system_error(errno, std::generic_category());
+    }
+
+    void flush()
+    {
+        if(std::fflush(f_) != 0)
+            throw std::system_error(errno, std::generic_category());
+    }
+
+private:
+    void put(std::uint64_t v)
+    {
+        unsigned char buf[10];
+        std::size_t n = 0;
+        do
+        {
+            buf[n] = static_cast<unsigned char>(v & 0x7f);
+            v >>= 7;
+            if(v != 0)
+                buf[n] |= 0x80;
+            ++n;
+        }
+        while(v != 0);
+        if(std::fwrite(buf, 1, n, f_) != n)
+            throw std::system_error(errno, std::generic_category());
+    }
+
+    std::FILE* f_;
+};
+
+/** One read from a trace.
+*/
+struct record
+{
+    std::chrono::nanoseconds delay;
+    std::string_view bytes;
+};
+
+/** Walks the records of a mapped trace file without copying them.
+
+    The whole file is validated on construction, which throws
+    `std::runtime_error` if it is not a complete trace.
+*/
+class reader
+{
+public:
+    explicit reader(mapped_file const& f)
+        : data_(f.view())
+    {
+        if(data_.substr(0, sizeof(magic)) != std::string_view(magic, sizeof(magic)))
+            throw std::runtime_error("not a trace file");
+        pos_ = sizeof(magic);
+        record r;
+        while(next(r))
+            ++count_;
+        if(pos_ != data_.size())
+            throw std::runtime_error("truncated trace file");
+        pos_ = sizeof(magic);
+    }
+
+    // Number of records in the trace
+    std::size_t size() const noexcept
+    {
+        return count_;
+    }
+
+    // Reads the next record, returning false at the end
+    bool next(record& r) noexcept
+    {
+        std::uint64_t delay;
+        std::uint64_t size;
+        std::size_t pos = pos_;
+        if(! get(pos, delay) || ! get(pos, size) || size > data_.size() - pos)
+            return false;
+        r.delay = std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(delay));
+        r.bytes = data_.substr(pos, static_cast<std::size_t>(size));
+        pos_ = pos + static_cast<std::size_t>(size);
+        return true;
+    }
+
+private:
+    bool get(std::size_t& pos, std::uint64_t& v) const noexcept
+    {
+        v = 0;
+        for(unsigned shift = 0; shift < 64 && pos < data_.size(); shift += 7)
+        {
+            auto b = static_cast<unsigned char>(data_[pos++]);
+            v |= std::uint64_t(b & 0x7f) << shift;
+            if(! (b & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    std::string_view data_;
+    std::size_t pos_ = 0;
+    std::size_t count_ = 0;
+};
+
+/** How a replay paces its reads.
+*/
+enum class timing
+{
+    // Every read completes as soon as it is made
+    full_speed,
+
+    // Each read completes no earlier than it did when recorded
+    original
+};
+
+/** Replay position and pacing shared by the co and cb streams.
+*/
+class player
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    player(mapped_file const& f, timing t)
+        : reader_(f), timing_(t)
+    {
+        has_next_ = reader_.next(next_);
+        if(timing_ == timing::original)
+        {
+            timer_fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if(timer_fd_ < 0)
+                throw std::system_error(errno, std::generic_category());
+        }
+    }
+
+    player(player const&) = delete;
+    player& operator=(player const&) = delete;
+
+    ~player()
+    {
+        if(timer_fd_ >= 0)
+            ::close(timer_fd_);
+    }
+
+    std::size_t size() const noexcept
+    {
+        return reader_.size();
+    }
+
+    // True if the next read may complete now; the end of the trace always may
+    bool due() noexcept
+    {
+        if(! has_next_ || timing_ == timing::full_speed)
+            return true;
+        // Time starts with the first read
+        if(! started_)
+        {
+            due_ = clock::now() + next_.delay;
+            started_ = true;
+        }
+        return clock::now() >= due_;
+    }
+
+    // True if the next read has a record and is due
+    bool ready() noexcept
+    {
+        return has_next_ && due();
+    }
+
+    // Returns the bytes of the next record and moves past it; empty at the end
+    std::string_view take() noexcept
+    {
+        if(! has_next_)
+        {
+            ended_ = true;
+            return {};
+        }
+        auto bytes = next_.bytes;
+        has_next_ = reader_.next(next_);
+        if(has_next_ && started_)
+            due_ += next_.delay;
+        return bytes;
+    }
+
+    /** Runs `w` on `ex` once the next read is due.
+
+        The wait uses a timerfd through the executor's reactor if it has
+        one; otherwise `w` is posted at once and must call `due()` again.
+    */
+    template<class Executor>
+    void wait(Executor const& ex, work* w)
+    {
+        if(due())
+        {
+            ex.post(w);
+            return;
+        }
+        itimerspec its{};
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            due_.time_since_epoch()).count();
+        its.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+        its.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+        // steady_clock is CLOCK_MONOTONIC on Linux
+        ::timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &its, nullptr);
+        if constexpr(requires { ex.post_when_ready(w, 0, wait_type::read); })
+        {
+            if(ex.post_when_ready(w, timer_fd_, wait_type::read))
+                return;
+        }
+        ex.post(w);
+    }
+
+    // True once a read has gone past the last record
+    bool ended() const noexcept
+    {
+        return ended_;
+    }
+
+    // Called when a waiting item runs: clears the timer and reports whether the read is due
+    bool fire() noexcept
+    {
+        if(timer_fd_ >= 0)
+        {
+            std::uint64_t n;
+            [[maybe_unused]] auto r = ::read(timer_fd_, &n, sizeof(n));
+        }
+        return due();
+    }
+
+private:
+    reader reader_;
+    record next_{};
+    bool has_next_ = false;
+    bool ended_ = false;
+    timing timing_;
+    bool started_ = false;
+    clock::time_point due_{};
+    int timer_fd_ = -1;
+};
+
+// The bytes a read result carries, or none if it carries no view
+template<class T>
+std::string_view bytes_of(T const& v) noexcept
+{
+    if constexpr(std::is_convertible_v<T const&, std::string_view>)
+        return v;
+    else
+        return {};
+}
+
+} // trace
+
+//----------------------------------------------------------
+
+namespace co {
+
+/** A stream adapter which records every read of the wrapped stream.
+
+    Each completed `async_read_some` appends a record to a trace:
+    the time since the previous read completed and the bytes the read
+    yielded. Like `tls_stream` it can wrap any stream and be wrapped in
+    turn, so a capture can be taken at any layer. A read which finds
+    the end of a stream that reports one through `at_end()` is not
+    recorded, so a recording of a replay reproduces the trace.
+
+    @tparam Stream The stream type to wrap.
+
+    @see trace::writer
+*/
+template<class Stream>
+struct recording_stream
+{
+    Stream stream_;
+
+    template<class... Args>
+    explicit recording_stream(trace::writer& w, Args&&... args)
+        : stream_(std::forward<Args>(args)...), w_(&w), last_(clock::now()) {}
+
+    auto get_executor() const { return stream_.get_executor(); }
+
+    template<class Awaitable>
+    struct async_read_some_t
+    {
+        Awaitable a_;
+        recording_stream* s_;
+
+        bool await_ready() { return a_.await_ready(); }
+
+        decltype(auto) await_suspend(coro h, any_executor const& ex)
+        {
+            return a_.await_suspend(h, ex);
+        }
+
+        decltype(auto) await_resume()
+        {
+            using result = decltype(a_.await_resume());
+            if constexpr(std::is_void_v<result>)
+            {
+                a_.await_resume();
+                s_->record({});
+            }
+            else
+            {
+                result r = a_.await_resume();
+                s_->record(trace::bytes_of(r));
+                return r;
+            }
+        }
+    };
+
+    auto async_read_some()
+    {
+        using inner = decltype(stream_.async_read_some());
+        return async_read_some_t<inner>{ stream_.async_read_some(), this };
+    }
+
+    template<class Stream2 = Stream>
+    requires requires(Stream2& s) { s.get_frame_allocator(); }
+    auto& get_frame_allocator()
+    {
+        return stream_.get_frame_allocator();
+    }
+
+    template<class Stream2 = Stream>
+    requires requires(Stream2 const& s) { s.at_end(); }
+    bool at_end() const noexcept
+    {
+        return stream_.at_end();
+    }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    void record(std::string_view bytes)
+    {
+        if constexpr(requires { stream_.at_end(); })
+        {
+            if(stream_.at_end())
+                return;
+        }
+        auto now = clock::now();
+        w_->record(now - last_, bytes);
+        last_ = now;
+    }
+
+    trace::writer* w_;
+    clock::time_point last_;
+};
+
+/** A stream which replays a recorded trace, usable wherever `co::socket` is.
+
+    Each `async_read_some()` yields a view of the next record's bytes
+    in the mapped trace. At full speed a read with a record left is
+    ready at once, as for `mmap_stream`. With the original timing a
+    read that is not yet due suspends until it is, waiting on a
+    timerfd through the executor's reactor. After the last record a
+    read completes through the executor with an empty view and
+    `at_end()` becomes true; a recorded read of no bytes also yields
+    an empty view, but leaves `at_end()` false.
+
+    @par Example
+    @code
+    mapped_file f("capture.trace");
+    co::replay_stream s(f, trace::timing::original);
+    for(;;)
+    {
+        std::string_view v = co_await s.async_read_some();
+        if(s.at_end())
+            break;
+        consume(v);
+    }
+    @endcode
+*/
+class replay_stream
+{
+public:
+    struct async_read_some_t : work
+    {
+        explicit async_read_some_t(replay_stream& s) noexcept
+            : s_(&s) {}
+
+        bool await_ready() noexcept
+        {
+            return s_->player_.ready();
+        }
+
+        std::coroutine_handle<> await_suspend(coro h, any_executor const& ex)
+        {
+            h_ = h;
+            ex_ = &ex;
+            s_->player_.wait(ex, this);
+            return std::noop_coroutine();
+        }
+
+        std::string_view await_resume() noexcept
+        {
+            ++g_io_count;
+            return s_->player_.take();
+        }
+
+        // Embedded in the awaitable, in the awaiting frame
+        void destroy() noexcept override {}
+
+        void operator()() override
+        {
+            if(! s_->player_.fire())
+            {
+                s_->player_.wait(*ex_, this);
+                return;
+            }
+            ex_->dispatch(h_)();
+        }
+
+    private:
+        replay_stream* s_;
+        coro h_;
+        any_executor const* ex_ = nullptr;
+    };
+
+    explicit replay_stream(mapped_file const& f, trace::timing t = trace::timing::full_speed)
+        : player_(f, t)
+    {
+    }
+
+    async_read_some_t async_read_some() noexcept
+    {
+        return async_read_some_t(*this);
+    }
+
+    // True once a read has found the end of the trace
+    bool at_end() const noexcept
+    {
+        return player_.ended();
+    }
+
+    detail::frame_pool& get_frame_allocator()
+    {
+        return pool_;
+    }
+
+private:
+    trace::player player_;
+    detail::frame_pool pool_;
+};
+
+} // co
+
+//----------------------------------------------------------
+
+namespace cb {
+
+namespace detail {
+
+template<class Stream, class Handler>
+struct record_handler
+{
+    Stream* s_;
+    Handler handler_;
+
+    auto get_allocator() const noexcept
+    {
+        return get_associated_allocator(handler_);
+    }
+
+    void operator()()
+    {
+        s_->record();
+        handler_();
+    }
+};
+
+// Waits until a replayed read is due, then completes like io_op
+template<class Stream, class Executor, class Handler>
+struct replay_op : work
+{
+    Stream* s_;
+    Executor ex_;
+    Handler handler_;
+
+    replay_op(Stream& s, Executor ex, Handler h)
+        : s_(&s), ex_(ex), handler_(std::move(h)) {}
+
+    void operator()() override
+    {
+        if(! s_->player_.fire())
+        {
+            s_->player_.wait(ex_, this);
+            return;
+        }
+        s_->last_ = s_->player_.take();
+        auto h = std::move(handler_);
+        auto ex = ex_;
+        auto alloc = get_associated_allocator(h);
+        this->~replay_op();
+        alloc.deallocate(this, sizeof(replay_op));
+        ex.dispatch(std::move(h));
+    }
+
+    // The memory came from the handler's allocator
+    void destroy() noexcept override
+    {
+        auto alloc = get_associated_allocator(handler_);
+        this->~replay_op();
+        alloc.deallocate(this, sizeof(replay_op));
+    }
+};
+
+} // detail
+
+/** A stream adapter which records every read of the wrapped stream.
+
+    Handlers take no arguments, so the bytes recorded are those the
+    wrapped stream's `buffer()` reports, if it has one.
+
+    @tparam Stream The stream type to wrap.
+
+    @see co::recording_stream
+*/
+template<class Stream>
+struct recording_stream
+{
+    Stream stream_;
+
+    template<class... Args>
+    explicit recording_stream(trace::writer& w, Args&&... args)
+        : stream_(std::forward<Args>(args)...), w_(&w), last_(clock::now()) {}
+
+    auto get_executor() const { return stream_.get_executor(); }
+
+    template<class Handler>
+    void async_read_some(Handler&& handler)
+    {
+        stream_.async_read_some(detail::record_handler<recording_stream, std::decay_t<Handler>>{
+            this, std::forward<Handler>(handler) });
+    }
+
+    template<class Stream2 = Stream>
+    requires requires(Stream2 const& s) { s.buffer(); }
+    std::string_view buffer() const noexcept
+    {
+        return stream_.buffer();
+    }
+
+    template<class Stream2 = Stream>
+    requires requires(Stream2 const& s) { s.at_end(); }
+    bool at_end() const noexcept
+    {
+        return stream_.at_end();
+    }
+
+private:
+    template<class, class>
+    friend struct detail::record_handler;
+
+    using clock = std::chrono::steady_clock;
+
+    void record()
+    {
+        if constexpr(requires { stream_.at_end(); })
+        {
+            if(stream_.at_end())
+                return;
+        }
+        std::string_view bytes;
+        if constexpr(requires { stream_.buffer(); })
+            bytes = stream_.buffer();
+        auto now = clock::now();
+        w_->record(now - last_, bytes);
+        last_ = now;
+    }
+
+    trace::writer* w_;
+    clock::time_point last_;
+};
+
+/** A stream which replays a recorded trace, usable wherever `cb::socket` is.
+
+    The bytes of the last read are available from `buffer()`. Every
+    read is posted to the executor, after waiting on a timerfd when
+    the original timing is kept and the read is not yet due.
+
+    @tparam Executor The executor type used for completion.
+
+    @see co::replay_stream
+*/
+template<class Executor>
+class replay_stream
+{
+public:
+    replay_stream(Executor ex, mapped_file const& f, trace::timing t = trace::timing::full_speed)
+        : ex_(ex), player_(f, t)
+    {
+    }
+
+    Executor get_executor() const { return ex_; }
+
+    template<class Handler>
+    void async_read_some(Handler&& handler)
+    {
+        ++g_io_count;
+        using op_t = detail::replay_op<replay_stream, Executor, std::decay_t<Handler>>;
+        auto alloc = get_associated_allocator(handler);
+        void* p = alloc.allocate(sizeof(op_t));
+        player_.wait(ex_, ::new(p) op_t(*this, ex_, std::forward<Handler>(handler)));
+    }
+
+    // The bytes of the last read; empty after the end of the trace
+    std::string_view buffer() const noexcept
+    {
+        return last_;
+    }
+
+    // True once a read has found the end of the trace
+    bool at_end() const noexcept
+    {
+        return player_.ended();
+    }
+
+private:
+    template<class, class, class>
+    friend struct detail::replay_op;
+
+    Executor ex_;
+    trace::player player_;
+    std::string_view last_;
+};
+
+} // cb
+
+#endif
+
+#endif
@@ -0,0 +1,354 @@
+//
+// Copyright (c) 2025 Vinnie Falco (vinnie dot falco at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/cppalliance/wg21-papers/coro-first-io
+//
+
+// Measures the build cost of composing operations in each style.
+//
+// For each style this program writes a library of N distinct composed
+// operations spread over several translation units, compiles every unit
+// with the compiler and flags the benchmark was built with, links them
+// into a program and runs it. Operations nest up to four deep, the way
+// protocol layers do, and each is used with two stream types; callback
+// operations are also used with two handler types, since their types
+// carry the handler. It reports compile time, object size, link time and
+// binary size.
+// A co::socket supports one read at a time, so the generated programs run
+// each operation to completion before starting the next.
+//
+// usage: codesize [operations [translation-units]]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifndef CODESIZE_CXX
+#define CODESIZE_CXX "c++"
+#endif
+
+#ifndef CODESIZE_CXX_FLAGS
+#define CODESIZE_CXX_FLAGS "-O2"
+#endif
+
+#ifndef CODESIZE_SOURCE_DIR
+#define CODESIZE_SOURCE_DIR "."
+#endif
+
+namespace fs = std::filesystem;
+
+// Reads performed by operation j before its nested operation
+static int reads_of(int j)
+{
+    return j % 5 + 1;
+}
+
+// Operation j nests operation j - 1, in chains of four
+static bool nests(int j)
+{
+    return j % 4 != 0;
+}
+
+struct build_result
+{
+    double compile_total = 0;
+    double compile_max = 0;
+    std::uintmax_t object_bytes = 0;
+    double link = 0;
+    std::uintmax_t binary_bytes = 0;
+    bool ok = true;
+};
+
+struct style
+{
+    char const* name;
+    void (*write_unit)(std::ostream&, int unit, int first, int last);
+    void (*write_main)(std::ostream&, int ops, int units);
+};
+
+//----------------------------------------------------------
+
+static void write_cb_unit(std::ostream& os, int unit, int first, int last)
+{
+    os << "#include \"bench_cb.hpp\"\n\n"
+       << "using sock_t = cb::socket<io_context::executor>;\n"
+       << "using tls_t = cb::tls_stream<sock_t>;\n\n"
+       << "namespace gen" << unit << " {\n\n";
+    for(int j = first; j < last; ++j)
+    {
+        os << "template<class Stream, class Handler>\n"
+           << "struct op" << j << "\n"
+           << "{\n"
+           << "    Stream* stream_;\n"
+           << "    Handler handler_;\n"
+           << "    int count_ = 0;\n\n"
+           << "    op" << j << "(Stream& s, Handler h) : stream_(&s), handler_(std::move(h)) {}\n\n"
+           << "    auto get_allocator() const noexcept { return cb::get_associated_allocator(handler_); }\n\n"
+           << "    void operator()()\n"
+           << "    {\n"
+           << "        if(count_ < " << reads_of(j) << ")\n"
+           << "        {\n"
+           << "            ++count_;\n"
+           << "            stream_->async_read_some(std::move(*this));\n"
+           << "            return;\n"
+           << "        }\n";
+        if(nests(j) && j > first)
+            os << "        if(count_++ == " << reads_of(j) << ")\n"
+               << "        {\n"
+               << "            auto& s = *stream_;\n"
+               << "            op" << j - 1 << "<Stream, op" << j << ">(s, std::move(*this))();\n"
+               << "            return;\n"
+               << "        }\n";
+        os << "        handler_();\n"
+           << "    }\n"
+           << "};\n\n";
+    }
+    os << "} // gen" << unit << "\n\n";
+    for(int j = first; j < last; ++j)
+        os << "void run" << j << "(sock_t& s, tls_t& t, int& n)\n"
+           << "{\n"
+           << "    gen" << unit << "::op" << j << "<sock_t, cb::callback>(s, cb::callback(n))();\n"
+           << "    gen" << unit << "::op" << j << "<tls_t, cb::callback>(t, cb::callback(n))();\n"
+           << "    gen" << unit << "::op" << j << "<sock_t, cb::sized_callback<64>>(s, cb::sized_callback<64>(n))();\n"
+           << "    gen" << unit << "::op" << j << "<tls_t, cb::sized_callback<64>>(t, cb::sized_callback<64>(n))();\n"
+           << "}\n\n";
+}
+
+static void write_cb_main(std::ostream& os, int ops, int)
+{
+    os << "#include \"bench_cb.hpp\"\n\n"
+       << "constinit thread_local std::size_t g_io_count = 0;\n"
+       << "constinit thread_local std::size_t g_work_count = 0;\n\n"
+       << "using sock_t = cb::socket<io_context::executor>;\n"
+       << "using tls_t = cb::tls_stream<sock_t>;\n\n";
+    for(int j = 0; j < ops; ++j)
+        os << "void run" << j << "(sock_t&, tls_t&, int&);\n";
+    os << "\nint main()\n"
+       << "{\n"
+       << "    io_context ioc;\n"
+       << "    sock_t s(ioc.get_executor());\n"
+       << "    tls_t t(ioc.get_executor());\n"
+       << "    int n = 0;\n";
+    for(int j = 0; j < ops; ++j)
+        os << "    run" << j << "(s, t, n);\n"
+           << "    ioc.run();\n";
+    os << "    return n == " << 4 * ops << " ? 0 : 1;\n"
+       << "}\n";
+}
+
+//----------------------------------------------------------
+
+static void write_co_unit(std::ostream& os, int unit, int first, int last)
+{
+    os << "#include \"bench_co.hpp\"\n\n"
+       << "using tls_t = co::tls_stream<co::socket>;\n\n"
+       << "namespace gen" << unit << " {\n\n"
+       << "static co::task counted(co::task t, int& n)\n"
+       << "{\n"
+       << "    co_await t;\n"
+       << "    ++n;\n"
+       << "}\n\n";
+    for(int j = first; j < last; ++j)
+    {
+        os << "template<class Stream>\n"
+           << "co::task op" << j << "(Stream& s)\n"
+           << "{\n"
+           << "    for(int i = 0; i < " << reads_of(j) << "; ++i)\n"
+           << "        co_await s.async_read_some();\n";
+        if(nests(j) && j > first)
+            os << "    co_await op" << j - 1 << "(s);\n";
+        os << "}\n\n";
+    }
+    os << "} // gen" << unit << "\n\n";
+    for(int j = first; j < last; ++j)
+        os << "void run" << j << "(io_context& ioc, co::socket& s, tls_t& t, int& n)\n"
+           << "{\n"
+           << "    co::async_run(ioc.get_executor(), gen" << unit << "::counted(gen" << unit << "::op" << j << "(s), n));\n"
+           << "    co::async_run(ioc.get_executor(), gen" << unit << "::counted(gen" << unit << "::op" << j << "(t), n));\n"
+           << "}\n\n";
+}
+
+static void write_co_main(std::ostream& os, int ops, int)
+{
+    os << "#include \"bench_co.hpp\"\n\n"
+       << "constinit thread_local std::size_t g_io_count = 0;\n"
+       << "constinit thread_local std::size_t g_work_count = 0;\n\n"
+       << "using tls_t = co::tls_stream<co::socket>;\n\n";
+    for(int j = 0; j < ops; ++j)
+        os << "void run" << j << "(io_context&, co::socket&, tls_t&, int&);\n";
+    os << "\nint main()\n"
+       << "{\n"
+       << "    io_context ioc;\n"
+       << "    co::socket s;\n"
+       << "    tls_t t;\n"
+       << "    int n = 0;\n";
+    for(int j = 0; j < ops; ++j)
+        os << "    run" << j << "(ioc, s, t, n);\n"
+           << "    ioc.run();\n";
+    os << "    return n == " << 2 * ops << " ? 0 : 1;\n"
+       << "}\n";
+}
+
+//----------------------------------------------------------
+
+// Runs a command, returning its wall time in seconds or -1 on failure
+static double timed(std::string const& cmd)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    int rc = std::system(cmd.c_str());
+    auto t1 = std::chrono::steady_clock::now();
+    if(rc != 0)
+    {
+        std::cerr << "failed: " << cmd << "\n";
+        return -1;
+    }
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+static build_result build(style const& st, int ops, int units, fs::path const& root)
+{
+    build_result r;
+    fs::path dir = root / st.name;
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    std::string compile = std::string("\"") + CODESIZE_CXX + "\" -std=c++20 "
+        CODESIZE_CXX_FLAGS " -I\"" CODESIZE_SOURCE_DIR "\" -c ";
+
+    std::vector<fs::path> objects;
+    auto compile_one = [&](fs::path const& src)
+    {
+        fs::path obj = src;
+        obj.replace_extension(".o");
+        double t = timed(compile + "\"" + src.string() + "\" -o \"" + obj.string() + "\"");
+        if(t < 0)
+        {
+            r.ok = false;
+            return;
+        }
+        r.compile_total += t;
+        r.compile_max = std::max(r.compile_max, t);
+        r.object_bytes += fs::file_size(obj);
+        objects.push_back(obj);
+    };
+
+    for(int u = 0; u < units; ++u)
+    {
+        fs::path src = dir / ("unit" + std::to_string(u) + ".cpp");
+        {
+            std::ofstream os(src);
+            st.write_unit(os, u, ops * u / units, ops * (u + 1) / units);
+        }
+        compile_one(src);
+    }
+    fs::path main_src = dir / "main.cpp";
+    {
+        std::ofstream os(main_src);
+        st.write_main(os, ops, units);
+    }
+    compile_one(main_src);
+    if(! r.ok)
+        return r;
+
+    fs::path exe = dir / "program";
+    std::string link = std::string("\"") + CODESIZE_CXX + "\" " CODESIZE_CXX_FLAGS " -pthread";
+    for(auto const& obj : objects)
+        link += " \"" + obj.string() + "\"";
+    link += " -o \"" + exe.string() + "\"";
+    r.link = timed(link);
+    if(r.link < 0)
+    {
+        r.ok = false;
+        return r;
+    }
+    r.binary_bytes = fs::file_size(exe);
+
+    // The program checks that every generated operation completed
+    if(timed("\"" + exe.string() + "\"") < 0)
+        r.ok = false;
+    return r;
+}
+
+// A scratch directory under the system's temporary directory, removed
+// with everything generated in it when the run ends
+struct scratch_dir
+{
+    fs::path path;
+
+    scratch_dir()
+        : path(fs::temp_directory_path() / ("codesize-" + std::to_string(
+            std::chrono::steady_clock::now().time_since_epoch().count())))
+    {
+        fs::create_directories(path);
+    }
+
+    scratch_dir(scratch_dir const&) = delete;
+    scratch_dir& operator=(scratch_dir const&) = delete;
+
+    ~scratch_dir()
+    {
+        std::error_code ec;
+        fs::remove_all(path, ec);
+    }
+};
+
+int main(int argc, char** argv)
+{
+#if defined(_MSC_VER)
+    (void)argc;
+    (void)argv;
+    std::cout << "codesize: only GCC and Clang command lines are supported\n";
+    return 0;
+#else
+    int ops = argc > 1 ? std::atoi(argv[1]) : 64;
+    int units = argc > 2 ? std::atoi(argv[2]) : 4;
+    if(ops < 1 || units < 1 || units > ops)
+    {
+        std::cerr << "usage: codesize [operations [translation-units]]\n";
+        return 2;
+    }
+
+    scratch_dir root;
+    style const styles[] = {
+        { "cb", write_cb_unit, write_cb_main },
+        { "co", write_co_unit, write_co_main },
+    };
+
+    std::cout << ops << " operations in " << units << " translation units, "
+              << CODESIZE_CXX << " " CODESIZE_CXX_FLAGS "\n";
+    build_result results[2];
+    for(int i = 0; i < 2; ++i)
+    {
+        auto const& r = results[i] = build(styles[i], ops, units, root.path);
+        if(! r.ok)
+        {
+            std::cout << "FAIL: " << styles[i].name << " build or run failed\n";
+            return 1;
+        }
+        std::cout << std::left << std::setw(3) << styles[i].name << std::right
+                  << std::fixed << std::setprecision(2)
+                  << ": compile " << std::setw(6) << r.compile_total << " s"
+                  << " (max unit " << std::setw(5) << r.compile_max << " s)"
+                  << ", objects " << std::setw(9) << r.object_bytes << " B"
+                  << ", link " << std::setw(5) << r.link << " s"
+                  << ", binary " << std::setw(9) << r.binary_bytes << " B\n";
+    }
+    auto const& cb = results[0];
+    auto const& co = results[1];
+    std::cout << "co/cb: compile " << co.compile_total / cb.compile_total
+              << ", objects " << double(co.object_bytes) / double(cb.object_bytes)
+              << ", binary " << double(co.binary_bytes) / double(cb.binary_bytes) << "\n";
+    return 0;
+#endif
+}